@@ -28,6 +28,8 @@ public:
     virtual bool isInvalid() const = 0;
     virtual QString lastError() = 0;
     virtual QAbstractItemModel* model() = 0;
+    // appended after the existing virtuals to keep the vtable of older plugins
+    virtual QVariant dataByColumnIndex(int columnIndex){ return data(columnNameByIndex(columnIndex)); }
 };
 
 class IDataSourceHolder {
@@ -41,6 +41,7 @@
 #include "lrpreviewreportwidget.h"
 #include "lrreportdesignwindowintrerface.h"
 #include "lrpreparedpagesintf.h"
+#include "lrpagesinkintf.h"
 
 class QPrinter;
 class QGraphicsScene;
@@ -159,6 +160,19 @@ public:
     QGraphicsScene* createPreviewScene(QObject *parent = 0);
     bool    printToPDF(const QString& fileName);
     bool    exportReport(QString exporterName, const QString &fileName = "", const QMap<QString, QVariant>& params = QMap<QString, QVariant>());
+    bool    renderToPageSink(IPageSink* pageSink);
+    void    setPageStreaming(bool value);
+    bool    pageStreaming();
+    void    setRenderMode(RenderMode value);
+    RenderMode renderMode();
+    void    setEventsProcessingInterval(int msec);
+    int     eventsProcessingInterval();
+    void    setTemplateCacheEnabled(bool value);
+    bool    templateCacheEnabled();
+    static void clearTemplateCache();
+    static void setTextMeasureCacheSize(int value);
+    static TextMeasureCacheStatistics textMeasureCacheStatistics();
+    static void clearTextMeasureCache();
     void    previewReport(PreviewHints hints = PreviewBarsUserSetting);
     void    previewReport(QPrinter* printer, PreviewHints hints = PreviewBarsUserSetting);
     void    designReport();
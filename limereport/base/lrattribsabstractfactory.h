@@ -61,10 +61,10 @@ public:
     bool unregisterCreator(const IdentifierType& id){
         return (m_factoryMap.remove(id) == 1) && (m_attribsMap.remove(id) == 1);
     }
-    ProductCreator objectCreator(const IdentifierType& id){
-        if (m_factoryMap.contains(id)){
-            return m_factoryMap[id];
-        } else return 0;
+    ProductCreator objectCreator(const IdentifierType& id) const {
+        // lookups don't modify the map, so they are safe from several threads
+        // once all creators are registered
+        return m_factoryMap.value(id, 0);
     }
     QString attribs(const IdentifierType& id){
         if (m_attribsMap.contains(id)){
@@ -57,12 +57,10 @@ public:
     bool unregisterCreator(const IdentifierType& id){
         return (m_factoryMap.remove(id)==1);
     }
-    ProductCreator objectCreator(const IdentifierType& id){
-        if (m_factoryMap.contains(id)){
-            return m_factoryMap[id];
-        } else {
-            return 0;
-        }
+    ProductCreator objectCreator(const IdentifierType& id) const {
+        // lookups don't modify the map, so they are safe from several threads
+        // once all creators are registered
+        return m_factoryMap.value(id, 0);
     }
     const FactoryMap& map(){return m_factoryMap;}
     int mapElementCount(){return m_factoryMap.count();}
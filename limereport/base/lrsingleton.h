@@ -39,15 +39,18 @@ class Singleton
 {
 public:
     static T& instance(){
-        if (0==inst){
-            inst = new T();
-            ::atexit( destroy );
-        } else {};
-        return *inst;
+        // initialization of a local static is thread safe
+        static T* result = create();
+        return *result;
     }
 private:
     static T* inst;
 private:
+    static T* create(){
+        inst = new T();
+        ::atexit( destroy );
+        return inst;
+    }
     static void destroy() {
         delete inst;
     }
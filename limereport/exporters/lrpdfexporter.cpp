@@ -16,9 +16,14 @@ bool VARIABLE_IS_NOT_USED registred = LimeReport::ExportersFactory::instance().r
 
 namespace LimeReport{
 
-PDFExporter::PDFExporter(ReportEnginePrivate *parent) : QObject(parent), m_reportEngine(parent)
+PDFExporter::PDFExporter(ReportEnginePrivate *parent) : QObject(parent), m_reportEngine(parent), m_printProcessor(0)
 {}
 
+PDFExporter::~PDFExporter()
+{
+    if (m_printProcessor) delete m_printProcessor;
+}
+
 bool PDFExporter::exportPages(ReportPages pages, const QString &fileName, const QMap<QString, QVariant> &params)
 {
     Q_UNUSED(params);
@@ -35,4 +40,37 @@ bool PDFExporter::exportPages(ReportPages pages, const QString &fileName, const
     return false;
 }
 
+void PDFExporter::setExportParams(const QString &fileName, const QMap<QString, QVariant> &params)
+{
+    Q_UNUSED(params);
+    m_fileName = fileName;
+}
+
+bool PDFExporter::startPages()
+{
+    if (m_fileName.isEmpty()) return false;
+    m_printer.reset(new QPrinter());
+    m_printer->setOutputFileName(m_fileName);
+    m_printer->setOutputFormat(QPrinter::PdfFormat);
+    if (m_printProcessor) delete m_printProcessor;
+    m_printProcessor = new PrintProcessor(m_printer.data());
+    return true;
+}
+
+bool PDFExporter::putPage(QSharedPointer<PageItemDesignIntf> page)
+{
+    if (!m_printProcessor) return false;
+    return m_printProcessor->printPage(page);
+}
+
+bool PDFExporter::finishPages()
+{
+    if (!m_printProcessor) return false;
+    delete m_printProcessor;
+    m_printProcessor = 0;
+    m_printer.reset();
+    m_reportEngine->emitPrintedToPDF(m_fileName);
+    return true;
+}
+
 }
@@ -2,16 +2,19 @@
 #define LRPDFEXPORTER_H
 
 #include <QObject>
+#include <QPrinter>
 #include "lrexporterintf.h"
 
 namespace LimeReport{
 class ReportEnginePrivate;
+class PrintProcessor;
 
-class PDFExporter : public QObject, public ReportExporterInterface
+class PDFExporter : public QObject, public ReportExporterInterface, public ReportExporterPageSinkInterface
 {
     Q_OBJECT
 public:
     explicit PDFExporter(ReportEnginePrivate *parent = NULL);
+    ~PDFExporter();
     // ReportExporterInterface interface
     bool exportPages(ReportPages pages, const QString &fileName, const QMap<QString, QVariant> &params);
     QString exporterName()
@@ -26,8 +29,16 @@ public:
     {
         return tr("Export to PDF");
     }
+    // ReportExporterPageSinkInterface interface
+    void setExportParams(const QString& fileName, const QMap<QString, QVariant>& params);
+    bool startPages();
+    bool putPage(QSharedPointer<PageItemDesignIntf> page);
+    bool finishPages();
 private:
     ReportEnginePrivate* m_reportEngine;
+    QString m_fileName;
+    QScopedPointer<QPrinter> m_printer;
+    PrintProcessor* m_printProcessor;
 };
 
 } //namespace LimeReport
@@ -307,8 +307,8 @@ void ChartItem::updateItemSize(DataSourceManager *dataManager, RenderPass , int
 {
 
     m_isEmpty = false;
-    if (dataManager && dataManager->dataSource(m_datasource)){
-        IDataSource* ds =  dataManager->dataSource(m_datasource);
+    IDataSource* ds = dataManager ? dataManager->dataSource(m_datasource) : 0;
+    if (ds){
         foreach (SeriesItem* series, m_series) {
             if (series->isEmpty()){
                 series->setLabelsColumn(m_labelsField);
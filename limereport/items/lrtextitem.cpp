@@ -30,6 +30,8 @@
 #include <QtGui>
 #include <QTextLayout>
 #include <QLocale>
+#include <QThread>
+#include <QAtomicInt>
 #include <QMessageBox>
 #include <math.h>
 
@@ -46,6 +48,8 @@
 namespace{
 
 const QString xmlTag = "TextItem";
+const int MIN_ADAPTED_FONT_SIZE = 2;
+QAtomicInt textLaidOutCharacters;
 
 LimeReport::BaseDesignIntf * createTextItem(QObject* owner, LimeReport::BaseDesignIntf*  parent){
     return new LimeReport::TextItem(owner,parent);
@@ -59,7 +63,8 @@ namespace LimeReport{
 TextItem::TextItem(QObject *owner, QGraphicsItem *parent)
     : ContentItemDesignIntf(xmlTag,owner,parent), m_angle(Angle0), m_trimValue(true), m_allowHTML(false),
       m_allowHTMLInFields(false), m_replaceCarriageReturns(false), m_followTo(""), m_follower(0), m_textIndent(0),
-      m_textLayoutDirection(Qt::LayoutDirectionAuto), m_hideIfEmpty(false), m_fontLetterSpacing(0)
+      m_textLayoutDirection(Qt::LayoutDirectionAuto), m_hideIfEmpty(false), m_fontLetterSpacing(0),
+      m_textDocumentWidth(0)
 {
     PageItemDesignIntf* pageItem = dynamic_cast<PageItemDesignIntf*>(parent);
     BaseDesignIntf* parentItem = dynamic_cast<BaseDesignIntf*>(parent);
@@ -289,9 +294,11 @@ void TextItem::Init()
 
 void TextItem::setContent(const QString &value)
 {
-    if (m_strText.compare(value)!=0){
+    if (content().compare(value)!=0){
         QString oldValue = m_strText;
 
+        // the content no longer continues the document of a sliced item
+        m_textSlice = TextSlice();
         m_strText = value;
 
         if (!isLoading()){
@@ -304,9 +311,21 @@ void TextItem::setContent(const QString &value)
 }
 
 QString TextItem::content() const{
+    if (m_textSlice.contentPending){
+        TextPtr text = m_textSlice.source->document;
+        m_strText = textPart(text, m_textSlice.position, text->characterCount() - 1);
+        m_textSlice.contentPending = false;
+    }
     return m_strText;
 }
 
+bool TextItem::isEmpty() const
+{
+    if (m_textSlice.contentPending)
+        return m_textSlice.source->lastTextPosition < m_textSlice.position;
+    return m_strText.trimmed().isEmpty();
+}
+
 void TextItem::updateItemSize(DataSourceManager* dataManager, RenderPass pass, int maxHeight)
 {
 
@@ -350,6 +369,8 @@ void TextItem::updateLayout()
 
 bool TextItem::isNeedExpandContent() const
 {   
+    if (m_textSlice.contentPending)
+        return m_textSlice.source->lastExpressionPosition >= m_textSlice.position || isContentBackedUp();
 #if (QT_VERSION < QT_VERSION_CHECK(5, 15, 1))
     QRegExp rx("$*\\{[^{]*\\}");
 #else
@@ -382,15 +403,47 @@ void TextItem::setTextFont(TextPtr text, const QFont& value) const {
     }
 }
 
-void TextItem::adaptFontSize(TextPtr text) const{
+bool TextItem::isTextFits(TextPtr text) const
+{
+    return text->size().height()<=this->height() && text->size().width()<=(this->width()) - marginSize() * 2;
+}
+
+void TextItem::adaptFontSize(TextPtr text, const TextLayoutKey& key) const{
     QFont _font = transformToSceneFont(font());
-    do{
-//        qApp->processEvents();
+    int fittedSize = 0;
+    if (TextMeasureCache::instance().findFittedFontSize(key, &fittedSize)){
+        _font.setPixelSize(fittedSize);
         setTextFont(text,_font);
-        if (_font.pixelSize()>2)
-            _font.setPixelSize(_font.pixelSize()-1);
-        else break;
-    } while(text->size().height()>this->height() || text->size().width()>(this->width()) - marginSize() * 2);
+        return;
+    }
+
+    setTextFont(text,_font);
+    fittedSize = _font.pixelSize();
+    if (fittedSize>MIN_ADAPTED_FONT_SIZE && !isTextFits(text)){
+        // the text grows with the font, so the largest fitting size is bisected,
+        // the minimal size is used even if the text does not fit in it
+        int low = MIN_ADAPTED_FONT_SIZE + 1;
+        int high = fittedSize - 1;
+        int lastSize = fittedSize;
+        fittedSize = MIN_ADAPTED_FONT_SIZE;
+        while (low<=high){
+            int size = (low + high) / 2;
+            _font.setPixelSize(size);
+            setTextFont(text,_font);
+            lastSize = size;
+            if (isTextFits(text)){
+                fittedSize = size;
+                low = size + 1;
+            } else {
+                high = size - 1;
+            }
+        }
+        if (lastSize != fittedSize){
+            _font.setPixelSize(fittedSize);
+            setTextFont(text,_font);
+        }
+    }
+    TextMeasureCache::instance().insertFittedFontSize(key, fittedSize);
 }
 
 int TextItem::underlineLineSize() const
@@ -424,10 +477,26 @@ void TextItem::setLineSpacing(int value)
 
 void TextItem::initTextSizes() const
 {
-    TextPtr text = textDocument();
-    m_textSize= text->size();
-    if (text->begin().isValid() && text->begin().layout()->lineAt(0).isValid())
-        m_firstLineSize = text->begin().layout()->lineAt(0).height();
+    if (isTextSliceValid()){
+        QSizeF documentSize = m_textSlice.source->document->size();
+        m_textSize = QSizeF(documentSize.width(), documentSize.height() - m_textSlice.top);
+        m_firstLineSize = m_textSlice.firstLineHeight;
+        return;
+    }
+    TextLayoutKey key = textLayoutKey();
+    TextMeasure measure;
+    if (!TextMeasureCache::instance().find(key, &measure)){
+        TextPtr text = textDocument();
+        measure.size = text->size();
+        if (text->begin().isValid() && text->begin().layout()->lineAt(0).isValid()){
+            measure.firstLineHeight = text->begin().layout()->lineAt(0).height();
+            measure.hasFirstLine = true;
+        }
+        TextMeasureCache::instance().insert(key, measure);
+    }
+    m_textSize = measure.size;
+    if (measure.hasFirstLine)
+        m_firstLineSize = measure.firstLineHeight;
 }
 
 QString TextItem::formatDateTime(const QDateTime &value)
@@ -508,10 +577,57 @@ QString TextItem::formatFieldValue()
 
 }
 
+TextLayoutKey TextItem::textLayoutKey(bool withText) const
+{
+    TextLayoutKey key;
+    if (withText)
+        key.text = content();
+    key.font = font();
+    key.size = rect().size();
+    // without font adaptation the layout depends only on the size used as text width
+    if (!(m_adaptFontToSize && (!(m_autoHeight || m_autoWidth)))){
+        if ((m_angle==Angle0)||(m_angle==Angle180))
+            key.size.setHeight(0);
+        else
+            key.size.setWidth(0);
+    }
+    key.margin = marginSize();
+    key.angle = m_angle;
+    key.alignment = m_alignment;
+    key.layoutDirection = m_textLayoutDirection;
+    key.autoWidth = m_autoWidth;
+    key.autoHeight = m_autoHeight;
+    key.adaptFontToSize = m_adaptFontToSize;
+    key.trimValue = m_trimValue;
+    key.allowHTML = m_allowHTML;
+    key.replaceCarriageReturns = m_replaceCarriageReturns;
+    key.hasFollower = follower() != 0;
+    key.lineSpacing = m_lineSpacing;
+    key.textIndent = m_textIndent;
+    return key;
+}
+
+int TextItem::laidOutCharacters()
+{
+    return textLaidOutCharacters.loadAcquire();
+}
+
 TextItem::TextPtr TextItem::textDocument() const
 {
-    TextPtr text(new QTextDocument);
-    QString content = m_trimValue ? m_strText.trimmed() : m_strText;
+    // the laid out document is reused until one of its inputs changes,
+    // paint() of the rotated by 45 and 315 degrees text changes its width,
+    // the document itself is owned by the TextDocumentCache of its thread,
+    // an item painted in another thread than it was rendered in lays it out anew
+    TextLayoutKey key = textLayoutKey();
+    TextPtr text = m_textDocument.toStrongRef();
+    if (text && text->thread() == QThread::currentThread() &&
+        m_textDocumentKey == key && text->textWidth() == m_textDocumentWidth){
+        TextDocumentCache::retain(text);
+        return text;
+    }
+
+    text = TextPtr(new QTextDocument);
+    QString content = m_trimValue ? this->content().trimmed() : this->content();
 
     if (allowHTML())
         if (isReplaceCarriageReturns()){
@@ -521,6 +637,7 @@ TextItem::TextPtr TextItem::textDocument() const
         }
     else
         text->setPlainText(content);
+    textLaidOutCharacters.fetchAndAddRelaxed(text->characterCount());
 
     QTextOption to;
     to.setAlignment(m_alignment);
@@ -538,7 +655,7 @@ TextItem::TextPtr TextItem::textDocument() const
 
     QFont _font = transformToSceneFont(font());
     if (m_adaptFontToSize && (!(m_autoHeight || m_autoWidth))){
-        adaptFontSize(text);
+        adaptFontSize(text, key);
     } else {
         setTextFont(text,_font);
     }
@@ -561,6 +678,10 @@ TextItem::TextPtr TextItem::textDocument() const
 
     }
 
+    m_textDocument = text;
+    m_textDocumentKey = key;
+    m_textDocumentWidth = text->textWidth();
+    TextDocumentCache::retain(text);
     return text;
 
 }
@@ -845,11 +966,9 @@ void TextItem::expandContent(DataSourceManager* dataManager, RenderPass pass)
     switch(pass){
     case FirstPass:
         if (!fillInSecondPass()){
-            context=expandUserVariables(context, pass, expandType, dataManager);
-            context=expandScripts(context, dataManager);
-            context=expandDataFields(context, expandType, dataManager);
+            context=expandTemplate(context, ExpandVariables | ExpandScripts | ExpandDataFields, expandType, dataManager);
         } else {
-            context=expandDataFields(context, expandType, dataManager);
+            context=expandTemplate(context, ExpandDataFields, expandType, dataManager);
         }
         break;
     case SecondPass:
@@ -857,8 +976,7 @@ void TextItem::expandContent(DataSourceManager* dataManager, RenderPass pass)
             restoreContent();
             context = content();
         }
-        context=expandUserVariables(context, pass, expandType, dataManager);
-        context=expandScripts(context, dataManager);
+        context=expandTemplate(context, ExpandVariables | ExpandScripts, expandType, dataManager);
     }
 
     if (expandType == NoEscapeSymbols && !m_varValue.isNull() &&m_valueType != Default) {
@@ -904,38 +1022,32 @@ bool TextItem::canBeSplitted(int height) const
     return height > m_firstLineSize;
 }
 
-QString TextItem::extractText(QTextBlock& curBlock, int height){
+int TextItem::textPartEnd(TextPtr text, int position, int height) const
+{
+    QTextBlock curBlock = text->findBlock(position);
     int curLine = 0;
+    if (curBlock.isValid() && curBlock.layout()->lineCount() > 0)
+        curLine = curBlock.layout()->lineForTextPosition(position - curBlock.position()).lineNumber();
     int linesHeight = 0;
-    QString resultText;
-    for (;curBlock != curBlock.document()->end() || curLine<=curBlock.lineCount(); curBlock = curBlock.next(), curLine = 0, resultText += '\n' ){
-        linesHeight+=curBlock.blockFormat().topMargin();
-        for (;curLine < curBlock.layout()->lineCount(); curLine++){
-            linesHeight += curBlock.layout()->lineAt(curLine).height() + lineSpacing();
-            if (height > 0 && linesHeight > (height-borderLineSize() * 2)) {goto loop_exit;}
-            resultText += curBlock.text().mid(curBlock.layout()->lineAt(curLine).textStart(),
-                                                   curBlock.layout()->lineAt(curLine).textLength());
+    for (; curBlock.isValid(); curBlock = curBlock.next(), curLine = 0){
+        if (curLine == 0)
+            linesHeight += curBlock.blockFormat().topMargin();
+        for (; curLine < curBlock.layout()->lineCount(); ++curLine){
+            QTextLine line = curBlock.layout()->lineAt(curLine);
+            linesHeight += line.height() + lineSpacing();
+            if (linesHeight > (height - borderLineSize() * 2))
+                return curBlock.position() + line.textStart();
         }
     }
-    loop_exit: return resultText;
+    return text->characterCount() - 1;
 }
 
-QString TextItem::getTextPart(int height, int skipHeight){
-
-    QString resultText = "";
-    TextPtr text = textDocument();
-    text->size().height();
-    QTextBlock curBlock = text->begin();
+QString TextItem::textPart(TextPtr text, int start, int end) const
+{
+    QString resultText;
     QTextCursor cursor(text.data());
-    cursor.movePosition(QTextCursor::Start);
-
-    if (skipHeight > 0){
-        resultText = extractText(curBlock, skipHeight);
-        cursor.movePosition(QTextCursor::Right, QTextCursor::MoveAnchor, resultText.length());
-    }
-
-    resultText = extractText(curBlock, height);
-    cursor.movePosition(QTextCursor::Right, QTextCursor::KeepAnchor, resultText.length());
+    cursor.setPosition(start);
+    cursor.setPosition(end, QTextCursor::KeepAnchor);
 
     if (allowHTML()){
         resultText = cursor.selection().toHtml();
@@ -948,6 +1060,78 @@ QString TextItem::getTextPart(int height, int skipHeight){
     return resultText;
 }
 
+TextItem::TextSliceSourcePtr TextItem::sliceSource(int* position) const
+{
+    if (isTextSliceValid()){
+        *position = m_textSlice.position;
+        return m_textSlice.source;
+    }
+    *position = 0;
+    TextSliceSourcePtr source(new TextSliceSource());
+    source->document = textDocument();
+    // lines are available only after the document has been laid out
+    source->document->size();
+    if (!allowHTML()){
+        // positions of the plain text are the positions of the document
+        QString text = source->document->toPlainText();
+        int position = text.size() - 1;
+        while (position >= 0 && text.at(position).isSpace()) --position;
+        source->lastTextPosition = position;
+        int expressionEnd = text.lastIndexOf('}');
+        source->lastExpressionPosition = expressionEnd > 0 ? text.lastIndexOf('{', expressionEnd - 1) : -1;
+    }
+    return source;
+}
+
+void TextItem::setTextSlice(TextSliceSourcePtr source, int position)
+{
+    TextPtr text = source->document;
+    m_textSlice = TextSlice();
+    // the lines of the rest are the same only if its layout does not depend on its height
+    QTextLine line;
+    QTextBlock block = text->findBlock(position);
+    if (m_angle == Angle0 && !m_adaptFontToSize && m_autoWidth == NoneAutoWidth &&
+        block.isValid() && block.layout()->lineCount() > 0)
+        line = block.layout()->lineForTextPosition(position - block.position());
+
+    if (!line.isValid() || allowHTML()){
+        setContent(textPart(text, position, text->characterCount() - 1));
+        if (!line.isValid()) return;
+    } else {
+        m_strText.clear();
+        m_textSlice.contentPending = true;
+    }
+    m_textSlice.source = source;
+    m_textSlice.position = position;
+    m_textSlice.top = text->documentLayout()->blockBoundingRect(block).top() + line.y();
+    m_textSlice.firstLineHeight = line.height();
+    m_textSlice.key = textLayoutKey(false);
+}
+
+bool TextItem::isTextSliceValid() const
+{
+    return !m_textSlice.source.isNull() && m_textSlice.key == textLayoutKey(false);
+}
+
+TextItem* TextItem::cloneSlicePart(QObject* owner, QGraphicsItem* parent)
+{
+    // a part gets its own content, the rest of this item isn't taken out for the copy
+    bool contentPending = m_textSlice.contentPending;
+    m_textSlice.contentPending = false;
+    TextItem* part = dynamic_cast<TextItem*>(cloneItem(itemMode(),owner,parent));
+    m_textSlice.contentPending = contentPending;
+    return part;
+}
+
+QString TextItem::getTextPart(int height, int skipHeight){
+    int start = 0;
+    TextPtr text = sliceSource(&start)->document;
+    if (skipHeight > 0)
+        start = textPartEnd(text, start, skipHeight);
+    int end = height > 0 ? textPartEnd(text, start, height) : text->characterCount() - 1;
+    return textPart(text, start, end);
+}
+
 void TextItem::restoreLinksEvent()
 {
     if (!followTo().isEmpty()){
@@ -967,7 +1151,7 @@ void TextItem::restoreLinksEvent()
 
 BaseDesignIntf *TextItem::cloneUpperPart(int height, QObject *owner, QGraphicsItem *parent)
 {
-    TextItem* upperPart = dynamic_cast<TextItem*>(cloneItem(itemMode(),owner,parent));
+    TextItem* upperPart = cloneSlicePart(owner,parent);
     upperPart->setContent(getTextPart(height,0));
     upperPart->initTextSizes();
     upperPart->setHeight(upperPart->textSize().height()+borderLineSize()*2);
@@ -976,8 +1160,11 @@ BaseDesignIntf *TextItem::cloneUpperPart(int height, QObject *owner, QGraphicsIt
 
 BaseDesignIntf *TextItem::cloneBottomPart(int height, QObject *owner, QGraphicsItem *parent)
 {
-    TextItem* bottomPart = dynamic_cast<TextItem*>(cloneItem(itemMode(),owner,parent));
-    bottomPart->setContent(getTextPart(0,height));
+    TextItem* bottomPart = cloneSlicePart(owner,parent);
+    // the bottom part continues from the lines of this item instead of laying out the rest again
+    int start = 0;
+    TextSliceSourcePtr source = sliceSource(&start);
+    bottomPart->setTextSlice(source, textPartEnd(source->document, start, height));
     bottomPart->initTextSizes();
     bottomPart->setHeight(bottomPart->textSize().height()+borderLineSize()*2);
     return bottomPart;
@@ -38,6 +38,7 @@
 #include "lritemdesignintf.h"
 #include "lritemdesignintf.h"
 #include "lrpageinitintf.h"
+#include "lrtextmeasurecache.h"
 
 namespace LimeReport {
 
@@ -116,7 +117,7 @@ public:
 
     bool canBeSplitted(int height) const;
     bool isSplittable() const { return true;}
-    bool isEmpty() const{return m_strText.trimmed().isEmpty();}
+    bool isEmpty() const;
     BaseDesignIntf* cloneUpperPart(int height, QObject *owner, QGraphicsItem *parent);
     BaseDesignIntf* cloneBottomPart(int height, QObject *owner, QGraphicsItem *parent);
     BaseDesignIntf* createSameTypeItem(QObject* owner=0, QGraphicsItem* parent=0);
@@ -187,6 +188,9 @@ public:
     int fontLetterSpacing() const;
     void setFontLetterSpacing(int fontLetterSpacing);
 
+    // characters of all documents laid out by text items so far, for the tests
+    static int laidOutCharacters();
+
 protected:
     void updateLayout();
     bool isNeedExpandContent() const;
@@ -199,14 +203,43 @@ protected:
 private:
     void initTextSizes() const;
     void setTextFont(TextPtr text, const QFont &value) const;
-    void adaptFontSize(TextPtr text) const;
+    void adaptFontSize(TextPtr text, const TextLayoutKey& key) const;
+    bool isTextFits(TextPtr text) const;
     QString formatDateTime(const QDateTime &value);
     QString formatNumber(const double value);
     QString formatFieldValue();
-    QString extractText(QTextBlock& curBlock, int height);
+    int textPartEnd(TextPtr text, int position, int height) const;
+    QString textPart(TextPtr text, int start, int end) const;
     TextPtr textDocument() const;
+    TextLayoutKey textLayoutKey(bool withText = true) const;
+private:
+    // Document laid out for the item which was sliced, shared by all its parts
+    struct TextSliceSource{
+        TextSliceSource(): lastTextPosition(-1), lastExpressionPosition(-1){}
+        TextPtr document;
+        // last character which isn't a space and start of the last {...} expression
+        int lastTextPosition;
+        int lastExpressionPosition;
+    };
+    typedef QSharedPointer<TextSliceSource> TextSliceSourcePtr;
+    // Rest of the source document from the position of this part, it is used
+    // instead of the own layout while the content and the layout options stay
+    // the same. The plain text content is taken from it only when asked for.
+    struct TextSlice{
+        TextSlice(): position(0), top(0), firstLineHeight(0), contentPending(false){}
+        TextSliceSourcePtr source;
+        TextLayoutKey key;
+        int position;
+        qreal top;
+        qreal firstLineHeight;
+        bool contentPending;
+    };
+    TextSliceSourcePtr sliceSource(int* position) const;
+    void setTextSlice(TextSliceSourcePtr source, int position);
+    bool isTextSliceValid() const;
+    TextItem* cloneSlicePart(QObject* owner, QGraphicsItem* parent);
 private:
-    QString m_strText;
+    mutable QString m_strText;
     Qt::Alignment m_alignment;
     bool m_autoHeight;
     AutoWidth m_autoWidth;
@@ -231,6 +264,10 @@ private:
     Qt::LayoutDirection m_textLayoutDirection;
     bool m_hideIfEmpty;
     int m_fontLetterSpacing;
+    mutable QWeakPointer<QTextDocument> m_textDocument;
+    mutable TextLayoutKey m_textDocumentKey;
+    mutable qreal m_textDocumentWidth;
+    mutable TextSlice m_textSlice;
 };
 
 }
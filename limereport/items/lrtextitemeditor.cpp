@@ -119,8 +119,7 @@ void TextItemEditor::initUI()
     QStringList dataWords;
 
     LimeReport::DataSourceManager* dm =  m_page->datasourceManager();
-    LimeReport::ScriptEngineManager& se = LimeReport::ScriptEngineManager::instance();
-    se.setDataManager(dm);
+    LimeReport::ScriptEngineManager& se = LimeReport::ScriptEngineManager::forDataManager(dm);
 
     ScriptEditor* scriptEditor = dynamic_cast<ScriptEditor*>(ui->codeEditor);
     if (scriptEditor){
@@ -0,0 +1,156 @@
+/***************************************************************************
+ *   This file is part of the Lime Report project                          *
+ *   Copyright (C) 2021 by Alexander Arin                                  *
+ *   arin_a@bk.ru                                                          *
+ *                                                                         *
+ **                   GNU General Public License Usage                    **
+ *                                                                         *
+ *   This library is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ **                  GNU Lesser General Public License                    **
+ *                                                                         *
+ *   This library is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation, either version 3 of the    *
+ *   License, or (at your option) any later version.                       *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library.                                      *
+ *   If not, see <http://www.gnu.org/licenses/>.                           *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ ****************************************************************************/
+#include "lrtextmeasurecache.h"
+
+#include <QMutexLocker>
+#include <QThreadStorage>
+#include <QTextDocument>
+
+namespace LimeReport{
+
+bool TextLayoutKey::operator==(const TextLayoutKey &other) const
+{
+    return size == other.size && margin == other.margin && angle == other.angle &&
+           alignment == other.alignment && layoutDirection == other.layoutDirection &&
+           autoWidth == other.autoWidth && autoHeight == other.autoHeight &&
+           adaptFontToSize == other.adaptFontToSize && trimValue == other.trimValue &&
+           allowHTML == other.allowHTML && replaceCarriageReturns == other.replaceCarriageReturns &&
+           hasFollower == other.hasFollower && lineSpacing == other.lineSpacing &&
+           textIndent == other.textIndent && font == other.font && text == other.text;
+}
+
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+uint qHash(const TextLayoutKey &key, uint seed)
+#else
+size_t qHash(const TextLayoutKey &key, size_t seed)
+#endif
+{
+    return qHash(key.text, seed) ^ qHash(key.font, seed) ^
+           qHash(qRound(key.size.width()) * 31 + qRound(key.size.height()), seed) ^
+           qHash(key.angle * 31 + key.autoWidth, seed);
+}
+
+TextMeasureCache::TextMeasureCache()
+    : m_measures(Const::DEFAULT_TEXT_MEASURE_CACHE_SIZE),
+      m_fittedFontSizes(Const::DEFAULT_TEXT_MEASURE_CACHE_SIZE), m_hits(0), m_misses(0),
+      m_fittedFontSizeHits(0), m_fittedFontSizeMisses(0)
+{}
+
+bool TextMeasureCache::find(const TextLayoutKey &key, TextMeasure *measure)
+{
+    QMutexLocker locker(&m_mutex);
+    TextMeasure* cached = m_measures.object(key);
+    if (cached){
+        *measure = *cached;
+        ++m_hits;
+        return true;
+    }
+    ++m_misses;
+    return false;
+}
+
+void TextMeasureCache::insert(const TextLayoutKey &key, const TextMeasure &measure)
+{
+    QMutexLocker locker(&m_mutex);
+    m_measures.insert(key, new TextMeasure(measure));
+}
+
+bool TextMeasureCache::findFittedFontSize(const TextLayoutKey &key, int *pixelSize)
+{
+    QMutexLocker locker(&m_mutex);
+    int* cached = m_fittedFontSizes.object(key);
+    if (cached){
+        *pixelSize = *cached;
+        ++m_fittedFontSizeHits;
+        return true;
+    }
+    ++m_fittedFontSizeMisses;
+    return false;
+}
+
+void TextMeasureCache::insertFittedFontSize(const TextLayoutKey &key, int pixelSize)
+{
+    QMutexLocker locker(&m_mutex);
+    m_fittedFontSizes.insert(key, new int(pixelSize));
+}
+
+void TextMeasureCache::setCapacity(int value)
+{
+    QMutexLocker locker(&m_mutex);
+    m_measures.setMaxCost(value);
+    m_fittedFontSizes.setMaxCost(value);
+}
+
+void TextMeasureCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_measures.clear();
+    m_fittedFontSizes.clear();
+    m_hits = 0;
+    m_misses = 0;
+    m_fittedFontSizeHits = 0;
+    m_fittedFontSizeMisses = 0;
+}
+
+TextMeasureCacheStatistics TextMeasureCache::statistics()
+{
+    QMutexLocker locker(&m_mutex);
+    TextMeasureCacheStatistics result;
+    result.capacity = int(m_measures.maxCost());
+    result.size = int(m_measures.size());
+    result.hits = m_hits;
+    result.misses = m_misses;
+    result.fittedFontSizeHits = m_fittedFontSizeHits;
+    result.fittedFontSizeMisses = m_fittedFontSizeMisses;
+    return result;
+}
+
+TextDocumentCache::TextDocumentCache()
+    : m_documents(Const::DEFAULT_TEXT_DOCUMENT_CACHE_SIZE)
+{}
+
+namespace {
+
+// the cache of a thread is deleted when the thread finishes, the one of the
+// main thread when the application is destroyed
+QThreadStorage<TextDocumentCache*> textDocumentCaches;
+
+}
+
+void TextDocumentCache::retain(TextPtr document)
+{
+    if (!textDocumentCaches.hasLocalData())
+        textDocumentCaches.setLocalData(new TextDocumentCache);
+    QCache<QTextDocument*, TextPtr>& documents = textDocumentCaches.localData()->m_documents;
+    if (!documents.object(document.data()))
+        documents.insert(document.data(), new TextPtr(document));
+}
+
+}
@@ -0,0 +1,119 @@
+/***************************************************************************
+ *   This file is part of the Lime Report project                          *
+ *   Copyright (C) 2021 by Alexander Arin                                  *
+ *   arin_a@bk.ru                                                          *
+ *                                                                         *
+ **                   GNU General Public License Usage                    **
+ *                                                                         *
+ *   This library is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ **                  GNU Lesser General Public License                    **
+ *                                                                         *
+ *   This library is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation, either version 3 of the    *
+ *   License, or (at your option) any later version.                       *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library.                                      *
+ *   If not, see <http://www.gnu.org/licenses/>.                           *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ ****************************************************************************/
+#ifndef LRTEXTMEASURECACHE_H
+#define LRTEXTMEASURECACHE_H
+
+#include <QString>
+#include <QFont>
+#include <QSizeF>
+#include <QCache>
+#include <QMutex>
+#include <QSharedPointer>
+
+#include "lrglobal.h"
+#include "base/lrsingleton.h"
+
+class QTextDocument;
+
+namespace LimeReport{
+
+// Everything the laid out text of a TextItem depends on
+struct TextLayoutKey{
+    QString text;
+    QFont font;
+    QSizeF size;
+    int margin;
+    int angle;
+    Qt::Alignment alignment;
+    int layoutDirection;
+    int autoWidth;
+    bool autoHeight;
+    bool adaptFontToSize;
+    bool trimValue;
+    bool allowHTML;
+    bool replaceCarriageReturns;
+    bool hasFollower;
+    int lineSpacing;
+    qreal textIndent;
+    bool operator==(const TextLayoutKey& other) const;
+};
+
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+uint qHash(const TextLayoutKey& key, uint seed = 0);
+#else
+size_t qHash(const TextLayoutKey& key, size_t seed = 0);
+#endif
+
+struct TextMeasure{
+    TextMeasure(): firstLineHeight(0), hasFirstLine(false){}
+    QSizeF size;
+    qreal firstLineHeight;
+    bool hasFirstLine;
+};
+
+// Process wide LRU of text measurements shared by all report engines
+class TextMeasureCache : public Singleton<TextMeasureCache>{
+    friend class Singleton<TextMeasureCache>;
+public:
+    bool find(const TextLayoutKey& key, TextMeasure* measure);
+    void insert(const TextLayoutKey& key, const TextMeasure& measure);
+    bool findFittedFontSize(const TextLayoutKey& key, int* pixelSize);
+    void insertFittedFontSize(const TextLayoutKey& key, int pixelSize);
+    void setCapacity(int value);
+    void clear();
+    TextMeasureCacheStatistics statistics();
+private:
+    TextMeasureCache();
+private:
+    QMutex m_mutex;
+    QCache<TextLayoutKey, TextMeasure> m_measures;
+    QCache<TextLayoutKey, int> m_fittedFontSizes;
+    qint64 m_hits;
+    qint64 m_misses;
+    qint64 m_fittedFontSizeHits;
+    qint64 m_fittedFontSizeMisses;
+};
+
+// LRU of the current thread which keeps the last laid out documents of text
+// items alive, an item refers to its document weakly and lays the text out
+// again once the document has been dropped from here. Every thread has its own
+// cache, so documents are only used and deleted in the thread they belong to.
+class TextDocumentCache{
+public:
+    typedef QSharedPointer<QTextDocument> TextPtr;
+    static void retain(TextPtr document);
+private:
+    TextDocumentCache();
+private:
+    QCache<QTextDocument*, TextPtr> m_documents;
+};
+
+}
+#endif // LRTEXTMEASURECACHE_H
@@ -26,6 +26,7 @@ SOURCES += \
     $$REPORT_PATH/bands/lrtearoffband.cpp \
     $$REPORT_PATH/serializators/lrxmlqrectserializator.cpp \
     $$REPORT_PATH/serializators/lrxmlbasetypesserializators.cpp \
+    $$REPORT_PATH/serializators/lrreporttemplate.cpp \
     $$REPORT_PATH/serializators/lrxmlreader.cpp \
     $$REPORT_PATH/serializators/lrxmlwriter.cpp \
     $$REPORT_PATH/scripteditor/lrscripteditor.cpp \
@@ -42,6 +43,7 @@ SOURCES += \
     $$REPORT_PATH/items/lrtextitemeditor.cpp \
     $$REPORT_PATH/items/lrshapeitem.cpp \
     $$REPORT_PATH/items/lrtextitem.cpp \
+    $$REPORT_PATH/items/lrtextmeasurecache.cpp \
     $$REPORT_PATH/items/lrverticallayout.cpp \
     $$REPORT_PATH/items/lrlayoutmarker.cpp \
     $$REPORT_PATH/items/lrabstractlayout.cpp \
@@ -114,6 +116,7 @@ HEADERS += \
     $$REPORT_PATH/serializators/lrxmlqrectserializator.h \
     $$REPORT_PATH/serializators/lrxmlserializatorsfactory.h \
     $$REPORT_PATH/serializators/lrxmlbasetypesserializators.h \
+    $$REPORT_PATH/serializators/lrreporttemplate.h \
     $$REPORT_PATH/serializators/lrxmlreader.h \
     $$REPORT_PATH/serializators/lrxmlwriter.h \
     $$REPORT_PATH/scripteditor/lrscripteditor.h \
@@ -124,6 +127,7 @@ HEADERS += \
     $$REPORT_PATH/items/editors/lrtextalignmenteditorwidget.h \
     $$REPORT_PATH/items/editors/lritemsborderseditorwidget.h \
     $$REPORT_PATH/items/lrtextitem.h \
+    $$REPORT_PATH/items/lrtextmeasurecache.h \
     $$REPORT_PATH/items/lrhorizontallayout.h \
     $$REPORT_PATH/items/lrtextitemeditor.h \
     $$REPORT_PATH/items/lrshapeitem.h \
@@ -180,6 +184,7 @@ HEADERS += \
     $$REPORT_PATH/lrpreparedpages.h \
     $$REPORT_PATH/lraxisdata.h \
     $$REPORT_PATH/lrpreparedpagesintf.h \
+    $$REPORT_PATH/lrpagesinkintf.h \
     $$REPORT_PATH/items/lrpageeditor.h \
     $$REPORT_PATH/items/lrborderframeeditor.h \
     $$REPORT_PATH/items/lrbordereditor.h
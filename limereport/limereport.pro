@@ -42,7 +42,8 @@ EXTRA_FILES += \
     $$PWD/lrcallbackdatasourceintf.h \
     $$PWD/lrpreviewreportwidget.h \
     $$PWD/lrreportdesignwindowintrerface.h \
-    $$PWD/lrpreparedpagesintf.h
+    $$PWD/lrpreparedpagesintf.h \
+    $$PWD/lrpagesinkintf.h
 
 include(limereport.pri)
 
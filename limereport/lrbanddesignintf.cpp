@@ -29,6 +29,7 @@
  ****************************************************************************/
 #include "lrbanddesignintf.h"
 #include "lritemdesignintf.h"
+#include "lrpageitemdesignintf.h"
 #include "lrglobal.h"
 #include <algorithm>
 #include <QGraphicsScene>
@@ -332,6 +333,7 @@ int BandDesignIntf::bandIndex() const
 void BandDesignIntf::setBandIndex(int value)
 {
     m_bandIndex=value;
+    if (m_parentBand) m_parentBand->m_childrenByType.clear();
 }
 
 void BandDesignIntf::changeBandIndex(int value, bool firstTime)
@@ -380,12 +382,14 @@ void BandDesignIntf::setKeepBottomSpace(bool value){
 void BandDesignIntf::addChildBand(BandDesignIntf *band)
 {
     m_childBands.append(band);
+    m_childrenByType.clear();
     connect(band,SIGNAL(destroyed(QObject*)),this,SLOT(childBandDeleted(QObject*)));
 }
 
 void BandDesignIntf::removeChildBand(BandDesignIntf *band)
 {
     m_childBands.removeAt(m_childBands.indexOf(band));
+    m_childrenByType.clear();
 }
 
 void BandDesignIntf::setParentBand(BandDesignIntf *band)
@@ -476,11 +480,15 @@ int BandDesignIntf::minChildIndex(QSet<BandDesignIntf::BandsType> ignoredBands)
 
 QList<BandDesignIntf *> BandDesignIntf::childrenByType(BandDesignIntf::BandsType type)
 {
+    QHash<int, QList<BandDesignIntf*> >::const_iterator it = m_childrenByType.constFind(type);
+    if (it != m_childrenByType.constEnd())
+        return it.value();
     QList<BandDesignIntf*> resList;
     foreach(BandDesignIntf* item,childBands()){
         if (item->bandType()==type) resList<<item;
     }
     std::sort(resList.begin(),resList.end(),bandIndexLessThen);
+    m_childrenByType.insert(type, resList);
     return resList;
 }
 
@@ -570,6 +578,7 @@ void BandDesignIntf::moveItemsDown(qreal startPos, qreal offset){
        if (item->pos().y()>=startPos)
            item->setPos(item->x(),item->y()+offset);
    }
+   childGeometryChangedEvent();
 }
 
 void BandDesignIntf::preparePopUpMenu(QMenu &menu)
@@ -717,6 +726,7 @@ BaseDesignIntf *BandDesignIntf::cloneBottomPart(int height, QObject *owner, QGra
             }
         }
     }
+    bottomPart->childGeometryChangedEvent();
 
     return bottomPart;
 }
@@ -743,6 +753,26 @@ void BandDesignIntf::emitBandReRendered(BandDesignIntf *oldBand, BandDesignIntf
     emit bandReRendered(oldBand, newBand);
 }
 
+void BandDesignIntf::setGroupFunctionValue(GroupFunction *groupFunction, const QVariant &value)
+{
+    m_groupFunctionValues.insert(groupFunction, value);
+    PageItemDesignIntf* page = dynamic_cast<PageItemDesignIntf*>(parentItem());
+    if (page) page->invalidateGroupFunctionTotals();
+}
+
+void BandDesignIntf::removeGroupFunctionValue(GroupFunction *groupFunction)
+{
+    if (m_groupFunctionValues.remove(groupFunction) > 0){
+        PageItemDesignIntf* page = dynamic_cast<PageItemDesignIntf*>(parentItem());
+        if (page) page->invalidateGroupFunctionTotals();
+    }
+}
+
+bool BandDesignIntf::isRenderSignalsConnected() const
+{
+    return receivers(SIGNAL(preparedForRender())) > 0 || receivers(SIGNAL(afterData())) > 0;
+}
+
 void BandDesignIntf::setSplittable(bool value){
     if (m_splitable!=value){
         bool oldValue = m_splitable;
@@ -867,6 +897,7 @@ void BandDesignIntf::setMarkerColor(QColor color)
 void BandDesignIntf::childBandDeleted(QObject *band)
 {
     m_childBands.removeAt(m_childBands.indexOf(reinterpret_cast<BandDesignIntf*>(band)));
+    m_childrenByType.clear();
 }
 
 bool BandDesignIntf::useAlternateBackgroundColor() const
@@ -1123,6 +1154,7 @@ void BandDesignIntf::updateItemSize(DataSourceManager* dataManager, RenderPass p
             foreach (BaseDesignIntf* item, childBaseItems()) {
                 item->setY(item->y() - minTop);
             }
+            childGeometryChangedEvent();
         }
         setHeight(findMaxBottom() + spaceBorder);
     }
@@ -50,6 +50,7 @@ public:
 };
 
 class BandDesignIntf;
+class GroupFunction;
 
 class BandMarker : public QGraphicsItem{
 public:
@@ -216,6 +217,7 @@ public:
     void objectLoadFinished();
     void emitBandRendered(BandDesignIntf *band);
     void emitBandReRendered(BandDesignIntf* oldBand, BandDesignIntf* newBand);
+    bool isRenderSignalsConnected() const;
 
     bool isSplittable() const {return m_splitable;}
     void setSplittable(bool value);
@@ -270,6 +272,10 @@ public:
     void setShiftItems(int shiftItems);    
     bool isNeedUpdateSize(RenderPass) const;
     void copyBandAttributes(BandDesignIntf* source);
+    // values the group functions took from this band
+    const QHash<GroupFunction*, QVariant>& groupFunctionValues() const {return m_groupFunctionValues;}
+    void setGroupFunctionValue(GroupFunction* groupFunction, const QVariant& value);
+    void removeGroupFunctionValue(GroupFunction* groupFunction);
 signals:
     void bandRendered(BandDesignIntf* band);
     void bandReRendered(BandDesignIntf* oldBand, BandDesignIntf* newBand);
@@ -311,6 +317,7 @@ private:
     BandDesignIntf*             m_parentBand;
     QString                     m_parentBandName;
     QList<BandDesignIntf*>      m_childBands;
+    QHash<int, QList<BandDesignIntf*> > m_childrenByType;
     QVector<PItemSortContainer> m_bandItems;
     BandMarker*                 m_bandMarker;
     bool                        m_tryToKeepTogether;
@@ -334,6 +341,7 @@ private:
     int 						m_bottomSpace;
     QMap<QString,QVariant>      m_bookmarks;
     int                         m_shiftItems;
+    QHash<GroupFunction*, QVariant> m_groupFunctionValues;
 };
 
 class DataBandDesignIntf : public BandDesignIntf{
@@ -40,6 +40,12 @@
 #include "lrbordereditor.h"
 #include <memory>
 #include <QMetaObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QAtomicPointer>
+#include <QScopedPointer>
+#include <QColor>
+#include <QFont>
 #include <QGraphicsSceneMouseEvent>
 #include <QApplication>
 #include <QDialog>
@@ -50,6 +56,206 @@
 namespace LimeReport
 {
 
+namespace {
+
+struct PropertyCopyTable{
+    // writable properties except objectName, in declaration order
+    QVector<int> properties;
+    // values of a new item, invalid where a property has to be written anyway
+    QVector<QVariant> defaults;
+    // the setter changes propertiesRevision()
+    QVector<bool> reported;
+};
+
+// tables depend on the class and the item mode only
+typedef QPair<const QMetaObject*, int> PropertyCopyTableKey;
+typedef QHash<PropertyCopyTableKey, const PropertyCopyTable*> PropertyCopyTables;
+
+// Tables are built once per class and item mode from new items only, so they don't
+// depend on the items cloned before, and never change afterwards. Readers look them
+// up in the current snapshot without locking; a new class is published as a new
+// snapshot. Old snapshots can still be in use and are kept until exit.
+class PropertyCopyTableRegistry{
+public:
+    PropertyCopyTableRegistry(): m_snapshot(new PropertyCopyTables()){
+        m_snapshots.append(m_snapshot.loadAcquire());
+    }
+    ~PropertyCopyTableRegistry(){
+        qDeleteAll(m_tables);
+        qDeleteAll(m_snapshots);
+    }
+    const PropertyCopyTable& table(BaseDesignIntf* item, BaseDesignIntf::ItemMode mode);
+private:
+    static PropertyCopyTable* buildTable(BaseDesignIntf* item, BaseDesignIntf::ItemMode mode);
+    static BaseDesignIntf* createDefaultItem(BaseDesignIntf* item, BaseDesignIntf::ItemMode mode);
+    static QVariant probeValue(const QMetaProperty& metaProperty, const QVariant& value);
+    static bool sameValue(const QMetaProperty& metaProperty, const QVariant& value1, const QVariant& value2);
+private:
+    QAtomicPointer<const PropertyCopyTables> m_snapshot;
+    QMutex m_mutex;
+    QList<const PropertyCopyTable*> m_tables;
+    QList<const PropertyCopyTables*> m_snapshots;
+};
+
+const PropertyCopyTable& PropertyCopyTableRegistry::table(BaseDesignIntf* item, BaseDesignIntf::ItemMode mode)
+{
+    PropertyCopyTableKey key(item->metaObject(), int(mode));
+    const PropertyCopyTable* table = m_snapshot.loadAcquire()->value(key);
+    if (table) return *table;
+
+    QMutexLocker locker(&m_mutex);
+    const PropertyCopyTables* snapshot = m_snapshot.loadAcquire();
+    table = snapshot->value(key);
+    if (!table){
+        table = buildTable(item, mode);
+        m_tables.append(table);
+        PropertyCopyTables* newSnapshot = new PropertyCopyTables(*snapshot);
+        newSnapshot->insert(key, table);
+        m_snapshots.append(newSnapshot);
+        m_snapshot.storeRelease(newSnapshot);
+    }
+    return *table;
+}
+
+BaseDesignIntf* PropertyCopyTableRegistry::createDefaultItem(BaseDesignIntf* item, BaseDesignIntf::ItemMode mode)
+{
+    BaseDesignIntf* result = item->createSameTypeItem();
+    result->setItemMode(mode);
+    result->objectLoadStarted();
+    return result;
+}
+
+QVariant PropertyCopyTableRegistry::probeValue(const QMetaProperty& metaProperty, const QVariant& value)
+{
+    // a valid value which differs from the given one, invalid for other types
+    if (metaProperty.isEnumType()){
+        QMetaEnum metaEnum = metaProperty.enumerator();
+        for (int i = 0; i < metaEnum.keyCount(); ++i){
+            if (metaEnum.value(i) != value.toInt())
+                return metaEnum.value(i);
+        }
+        return QVariant();
+    }
+    switch (metaProperty.userType()) {
+    case QMetaType::Bool:
+        return !value.toBool();
+    case QMetaType::Int:
+        return value.toInt() + 1;
+    case QMetaType::UInt:
+        return value.toUInt() + 1;
+    case QMetaType::Double:
+        return value.toDouble() + 1;
+    case QMetaType::QString:
+        return value.toString() + "_";
+    case QMetaType::QColor:
+        return QVariant::fromValue(value.value<QColor>() == QColor(Qt::red) ? QColor(Qt::green) : QColor(Qt::red));
+    case QMetaType::QFont:{
+        QFont font = value.value<QFont>();
+        font.setBold(!font.bold());
+        return QVariant::fromValue(font);
+    }
+    case QMetaType::QPointF:
+        return value.toPointF() + QPointF(1, 1);
+    case QMetaType::QSizeF:
+        return value.toSizeF() + QSizeF(1, 1);
+    case QMetaType::QRectF:
+        return value.toRectF().adjusted(1, 1, 2, 2);
+    default:
+        return QVariant();
+    }
+}
+
+bool PropertyCopyTableRegistry::sameValue(const QMetaProperty& metaProperty, const QVariant& value1, const QVariant& value2)
+{
+    // enum values are read with the enum type and probed as int
+    if (metaProperty.isEnumType())
+        return value1.toInt() == value2.toInt();
+    return value1 == value2;
+}
+
+PropertyCopyTable* PropertyCopyTableRegistry::buildTable(BaseDesignIntf* item, BaseDesignIntf::ItemMode mode)
+{
+    const QMetaObject* metaObject = item->metaObject();
+    PropertyCopyTable* table = new PropertyCopyTable();
+    int objectNameIndex = metaObject->indexOfProperty("objectName");
+    for (int i = 0; i < metaObject->propertyCount(); ++i){
+        if (i != objectNameIndex && metaObject->property(i).isWritable())
+            table->properties.append(i);
+    }
+    int count = table->properties.size();
+
+    QVector<QVariant> defaults;
+    QVector<QVariant> probes;
+    {
+        QScopedPointer<BaseDesignIntf> defaultItem(createDefaultItem(item, mode));
+        foreach(int index, table->properties){
+            QMetaProperty metaProperty = metaObject->property(index);
+            defaults.append(metaProperty.read(defaultItem.data()));
+            probes.append(probeValue(metaProperty, defaults.last()));
+        }
+    }
+    table->defaults = defaults;
+
+    // A default can be skipped only if no setter changes other properties. The probe
+    // values are written to a new item in declaration order and to another one in
+    // reverse order, a property which doesn't keep its value is changed by some other
+    // setter. Only for these properties the setters are then checked one by one.
+    // A property without a probe value is written with its default and is always
+    // copied, it can't be checked itself.
+    QVector<QVariant> values;
+    for (int i = 0; i < count; ++i)
+        values.append(probes.at(i).isValid() ? probes.at(i) : defaults.at(i));
+    QVector<int> candidates;
+    for (int pass = 0; pass < 2; ++pass){
+        QScopedPointer<BaseDesignIntf> probeItem(createDefaultItem(item, mode));
+        for (int k = 0; k < count; ++k){
+            int i = pass == 0 ? k : count - k - 1;
+            if (values.at(i).isValid())
+                metaObject->property(table->properties.at(i)).write(probeItem.data(), values.at(i));
+        }
+        for (int i = 0; i < count; ++i){
+            QMetaProperty metaProperty = metaObject->property(table->properties.at(i));
+            if (probes.at(i).isValid() && !candidates.contains(i) &&
+                !sameValue(metaProperty, metaProperty.read(probeItem.data()), probes.at(i)))
+                candidates.append(i);
+        }
+    }
+
+    // a property is reported if writing its probe changes the revision of a loaded item
+    {
+        QScopedPointer<BaseDesignIntf> probeItem(createDefaultItem(item, mode));
+        probeItem->objectLoadFinished();
+        for (int i = 0; i < count; ++i){
+            int revision = probeItem->propertiesRevision();
+            if (probes.at(i).isValid())
+                metaObject->property(table->properties.at(i)).write(probeItem.data(), probes.at(i));
+            table->reported.append(probeItem->propertiesRevision() != revision);
+        }
+    }
+
+    for (int i = 0; i < count; ++i){
+        if (!probes.at(i).isValid())
+            table->defaults[i] = QVariant();
+        if (candidates.isEmpty() || !values.at(i).isValid()) continue;
+        QScopedPointer<BaseDesignIntf> probeItem(createDefaultItem(item, mode));
+        metaObject->property(table->properties.at(i)).write(probeItem.data(), values.at(i));
+        foreach(int j, candidates){
+            QMetaProperty candidate = metaObject->property(table->properties.at(j));
+            if (j != i && !sameValue(candidate, candidate.read(probeItem.data()), defaults.at(j))){
+                table->defaults[i] = QVariant();
+                table->defaults[j] = QVariant();
+                // j can change without its own setter
+                table->reported[j] = false;
+            }
+        }
+    }
+    return table;
+}
+
+Q_GLOBAL_STATIC(PropertyCopyTableRegistry, propertyCopyTables)
+
+}
+
 BaseDesignIntf::BaseDesignIntf(const QString &storageTypeName, QObject *owner, QGraphicsItem *parent) :
     QObject(owner), QGraphicsItem(parent),
     m_resizeHandleSize(Const::RESIZE_HANDLE_SIZE*2),
@@ -88,7 +294,8 @@ BaseDesignIntf::BaseDesignIntf(const QString &storageTypeName, QObject *owner, Q
     m_itemGeometryLocked(false),
     m_isChangingPos(false),
     m_isMoveable(false),
-    m_shadow(false)
+    m_shadow(false),
+    m_propertiesRevision(0)
 
 
 {
@@ -264,16 +471,14 @@ QFont BaseDesignIntf::transformToSceneFont(const QFont& value) const
 
 QString BaseDesignIntf::expandDataFields(QString context, ExpandType expandType, DataSourceManager* dataManager)
 {
-    ScriptEngineManager& sm = ScriptEngineManager::instance();
-    if (sm.dataManager() != dataManager) sm.setDataManager(dataManager);
+    ScriptEngineManager& sm = ScriptEngineManager::forDataManager(dataManager);
     return sm.expandDataFields(context, expandType, m_varValue, this);
 }
 
 QString BaseDesignIntf::expandUserVariables(QString context, RenderPass pass, ExpandType expandType, DataSourceManager* dataManager)
 {
 
-    ScriptEngineManager& sm = ScriptEngineManager::instance();
-    if (sm.dataManager() != dataManager) sm.setDataManager(dataManager);
+    ScriptEngineManager& sm = ScriptEngineManager::forDataManager(dataManager);
     return sm.expandUserVariables(context, pass, expandType, m_varValue);
 
 }
@@ -281,12 +486,17 @@ QString BaseDesignIntf::expandUserVariables(QString context, RenderPass pass, Ex
 QString BaseDesignIntf::expandScripts(QString context, DataSourceManager* dataManager)
 {
 
-    ScriptEngineManager& sm = ScriptEngineManager::instance();
-    if (sm.dataManager() != dataManager) sm.setDataManager(dataManager);
+    ScriptEngineManager& sm = ScriptEngineManager::forDataManager(dataManager);
     return sm.expandScripts(context,m_varValue,this);
 
 }
 
+QString BaseDesignIntf::expandTemplate(QString context, int parts, ExpandType expandType, DataSourceManager *dataManager)
+{
+    ScriptEngineManager& sm = ScriptEngineManager::forDataManager(dataManager);
+    return sm.expandTemplate(context, parts, expandType, m_varValue, this);
+}
+
 void BaseDesignIntf::setupPainter(QPainter *painter) const
 {
     if (!painter) {
@@ -737,6 +947,7 @@ void BaseDesignIntf::updateItemAlign(){
         qreal rightBorder = parentPage ? parentPage->rightMargin() * Const::mmFACTOR : 0;
         qreal aviableSpace = parent->width()-(leftBorder+rightBorder);
         setPos(modifyPosForAlignedItem(pos()));
+        notifyParentGeometryChanged();
         if (m_itemAlign == ParentWidthItemAlign)
             setWidth(aviableSpace);
     }
@@ -938,6 +1149,7 @@ void BaseDesignIntf::setItemVisible(const bool &value)
 {
     if (isVisible()!=value){
         setVisible(value);
+        ++m_propertiesRevision;
         emit itemVisibleHasChanged(this);
     }
 }
@@ -1181,6 +1393,8 @@ void BaseDesignIntf::setGeometry(QRectF rect)
     m_rightRect = QRectF(width() - resizeHandleSize(), 0-resizeHandleSize(), resizeHandleSize()*2, height()+resizeHandleSize()*2);
     m_boundingRect = QRectF();
     updateSelectionMarker();
+    notifyParentGeometryChanged();
+    ++m_propertiesRevision;
     if (!isLoading()){
         geometryChangedEvent(geometry(), m_oldGeometry);
         emit geometryChanged(this, geometry(), m_oldGeometry);
@@ -1202,8 +1416,10 @@ void BaseDesignIntf::setGeometryProperty(QRect rect)
 {
     if ( rect != m_itemGeometry ){
         QRectF oldValue = geometry();
-        if ((rect.x() != geometry().x()) || (rect.y() != geometry().y()))
+        if ((rect.x() != geometry().x()) || (rect.y() != geometry().y())){
             setPos(rect.x(), rect.y());
+            notifyParentGeometryChanged();
+        }
         if (rect.width() != geometry().width())
             setWidth(rect.width());
         if (rect.height() != geometry().height())
@@ -1271,9 +1487,19 @@ QVariant BaseDesignIntf::itemChange(QGraphicsItem::GraphicsItemChange change, co
 
     if (change == QGraphicsItem::ItemPositionHasChanged) {
         updateSelectionMarker();
+        notifyParentGeometryChanged();
+        ++m_propertiesRevision;
         emit geometryChanged(this, geometry(), geometry());
     }
 
+    if (change == QGraphicsItem::ItemVisibleHasChanged) {
+        notifyParentGeometryChanged();
+    }
+
+    if (change == QGraphicsItem::ItemChildAddedChange || change == QGraphicsItem::ItemChildRemovedChange) {
+        childGeometryChangedEvent();
+    }
+
     if (change == QGraphicsItem::ItemSelectedChange) {
         turnOnSelectionMarker(value.toBool());
         emit itemSelectedHasBeenChanged(this, value.toBool());
@@ -1290,6 +1516,12 @@ void BaseDesignIntf::childAddedEvent(BaseDesignIntf *child)
     Q_UNUSED(child)
 }
 
+void BaseDesignIntf::notifyParentGeometryChanged()
+{
+    BaseDesignIntf* parent = dynamic_cast<BaseDesignIntf*>(parentItem());
+    if (parent) parent->childGeometryChangedEvent();
+}
+
 void BaseDesignIntf::parentChangedEvent(BaseDesignIntf *)
 {
 
@@ -1380,6 +1612,8 @@ void BaseDesignIntf::setItemPos(const QPointF &newPos)
     QPointF oldPos = pos();
     QPointF finalPos = modifyPosForAlignedItem(newPos);
     QGraphicsItem::setPos(finalPos);
+    // print mode items don't send position changes, so the parent is told here
+    notifyParentGeometryChanged();
     emit posChanging(this, finalPos, oldPos);
 }
 
@@ -1588,6 +1822,15 @@ void BaseDesignIntf::updateItemSize(DataSourceManager *dataManager, RenderPass p
 bool BaseDesignIntf::isNeedUpdateSize(RenderPass /*pass*/) const
 {return false;}
 
+bool BaseDesignIntf::hasSecondPassContent() const
+{
+    if (fillInSecondPass()) return true;
+    foreach(BaseDesignIntf* item, childBaseItems()){
+        if (item->hasSecondPassContent()) return true;
+    }
+    return false;
+}
+
 void BaseDesignIntf::drawPinArea(QPainter *painter) const
 {
     painter->drawRect(QRect(0, 0, 16, 16));
@@ -1661,10 +1904,7 @@ BaseDesignIntf *BaseDesignIntf::cloneItemWOChild(ItemMode mode, QObject *owner,
     clone->setItemMode(mode);
     clone->objectLoadStarted();
     clone->setReportSettings(this->reportSettings());
-    for (int i = 0; i < clone->metaObject()->propertyCount(); i++) {
-        if (clone->metaObject()->property(i).isWritable())
-            clone->setProperty(clone->metaObject()->property(i).name(), property(clone->metaObject()->property(i).name()));
-    }
+    clone->copyPropertiesFrom(this, true);
     clone->objectLoadFinished();
     return clone;
 }
@@ -1672,16 +1912,51 @@ BaseDesignIntf *BaseDesignIntf::cloneItemWOChild(ItemMode mode, QObject *owner,
 void BaseDesignIntf::initFromItem(BaseDesignIntf *source)
 {
     objectLoadStarted();
-    for (int i = 0; i < metaObject()->propertyCount(); i++) {
-        if (strcmp(metaObject()->property(i).name(),"objectName")!=0)
-            if (source->property(metaObject()->property(i).name()).isValid()) {
-                if (metaObject()->property(i).isWritable())
-                    setProperty(metaObject()->property(i).name(), source->property(metaObject()->property(i).name()));
-            }
-    }
+    copyPropertiesFrom(source);
     objectLoadFinished();
 }
 
+void BaseDesignIntf::copyPropertiesFrom(BaseDesignIntf *source, bool newItem)
+{
+    // A new item already has the class defaults, so the properties which the
+    // source left at their defaults are not written to it.
+    const QMetaObject* mo = metaObject();
+    bool sameClass = source->metaObject() == mo;
+    const PropertyCopyTable& table = propertyCopyTables()->table(this, itemMode());
+    for (int i = 0; i < table.properties.size(); ++i){
+        QMetaProperty metaProperty = mo->property(table.properties.at(i));
+        QVariant value = sameClass ? metaProperty.read(source) : source->property(metaProperty.name());
+        if (!value.isValid()) continue;
+        if (newItem && table.defaults.at(i).isValid() && table.defaults.at(i) == value) continue;
+        metaProperty.write(this, value);
+    }
+}
+
+BaseDesignIntf::PropertyValues BaseDesignIntf::changedProperties(ItemMode mode, bool reported)
+{
+    // the values copyPropertiesFrom() would write to a new item of this class,
+    // either of the properties whose change is reported by propertiesRevision()
+    // or of the other ones
+    PropertyValues result;
+    const QMetaObject* mo = metaObject();
+    const PropertyCopyTable& table = propertyCopyTables()->table(this, mode);
+    for (int i = 0; i < table.properties.size(); ++i){
+        if (table.reported.at(i) != reported) continue;
+        QVariant value = mo->property(table.properties.at(i)).read(this);
+        if (!value.isValid()) continue;
+        if (table.defaults.at(i).isValid() && table.defaults.at(i) == value) continue;
+        result.append(qMakePair(table.properties.at(i), value));
+    }
+    return result;
+}
+
+void BaseDesignIntf::writeProperties(const PropertyValues &values)
+{
+    const QMetaObject* mo = metaObject();
+    for (int i = 0; i < values.size(); ++i)
+        mo->property(values.at(i).first).write(this, values.at(i).second);
+}
+
 bool BaseDesignIntf::canBeSplitted(int height) const
 {Q_UNUSED(height); return false;}
 
@@ -1756,12 +2031,28 @@ QList<BaseDesignIntf*> BaseDesignIntf::allChildBaseItems()
 }
 
 BaseDesignIntf *BaseDesignIntf::childByName(const QString &name)
+{
+    // found children are remembered and checked before use, because they
+    // can be renamed, moved to another parent or deleted
+    QString key = name.toCaseFolded();
+    BaseDesignIntf* item = m_childrenByName.value(key);
+    if (item && item->objectName().compare(name,Qt::CaseInsensitive)==0 && isAncestorOf(item))
+        return item;
+    item = findChildByName(name);
+    if (item)
+        m_childrenByName.insert(key, item);
+    else
+        m_childrenByName.remove(key);
+    return item;
+}
+
+BaseDesignIntf *BaseDesignIntf::findChildByName(const QString &name)
 {
     foreach(BaseDesignIntf* item, childBaseItems()){
         if (item->objectName().compare(name,Qt::CaseInsensitive)==0){
             return item;
         } else {
-            BaseDesignIntf* child = item->childByName(name);
+            BaseDesignIntf* child = item->findChildByName(name);
             if (child) return child;
         }
     }
@@ -1775,12 +2066,14 @@ QWidget *BaseDesignIntf::defaultEditor()
 
 void BaseDesignIntf::notify(const QString &propertyName, const QVariant& oldValue, const QVariant& newValue)
 {
+    ++m_propertiesRevision;
     if (!isLoading())
         emit propertyChanged(propertyName, oldValue, newValue);
 }
 
 void BaseDesignIntf::notify(const QVector<QString>& propertyNames)
 {
+    ++m_propertiesRevision;
     if (!isLoading())
         emit propertyesChanged(propertyNames);
 }
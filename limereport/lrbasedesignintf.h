@@ -35,6 +35,7 @@
 #include <QtGui>
 #include <QtXml>
 #include <QMenu>
+#include <QPointer>
 #include "lrcollection.h"
 #include "lrglobal.h"
 #include "serializators/lrstorageintf.h"
@@ -98,6 +99,7 @@ class LIMEREPORT_EXPORT BaseDesignIntf :
     Q_PROPERTY(BorderStyle borderStyle READ borderStyle WRITE setBorderStyle)
 
     friend class ReportRender;
+    friend class BandRenderPlan;
 public:
     enum BGMode { TransparentMode, OpaqueMode};
     enum BorderStyle { NoStyle = Qt::NoPen,
@@ -262,6 +264,7 @@ public:
 
     virtual void updateItemSize(DataSourceManager* dataManager, RenderPass pass=FirstPass, int maxHeight=0);
     virtual bool isNeedUpdateSize(RenderPass) const;
+    virtual bool hasSecondPassContent() const;
     virtual BaseDesignIntf* cloneItem(LimeReport::BaseDesignIntf::ItemMode mode, QObject* owner=0, QGraphicsItem* parent=0);
     virtual BaseDesignIntf* cloneItemWOChild(LimeReport::BaseDesignIntf::ItemMode mode, QObject* owner=0, QGraphicsItem* parent=0);
     virtual BaseDesignIntf* createSameTypeItem(QObject* owner=0, QGraphicsItem* parent=0) = 0;
@@ -277,6 +280,8 @@ public:
 
     bool isLoaded(){return m_objectState==ObjectLoaded;}
     bool isLoading(){return m_objectState==ObjectLoading;}
+    // changes whenever a change of the item is reported
+    int propertiesRevision() const {return m_propertiesRevision;}
     void objectLoadStarted();
     void objectLoadFinished();
     virtual void parentObjectLoadFinished();
@@ -379,6 +384,8 @@ protected:
     virtual QVariant itemChange(GraphicsItemChange change, const QVariant &value);
     virtual void childAddedEvent(BaseDesignIntf* child);
     virtual void parentChangedEvent(BaseDesignIntf*);
+    virtual void childGeometryChangedEvent(){}
+    void notifyParentGeometryChanged();
     void restoreLinks();
     virtual void restoreLinksEvent(){}
 
@@ -409,6 +416,7 @@ protected:
     QString expandUserVariables(QString context, RenderPass pass, ExpandType expandType, DataSourceManager *dataManager);
     QString expandDataFields(QString context, ExpandType expandType, DataSourceManager *dataManager);
     QString expandScripts(QString context, DataSourceManager *dataManager);
+    QString expandTemplate(QString context, int parts, ExpandType expandType, DataSourceManager *dataManager);
 
     QVariant m_varValue;
 
@@ -423,10 +431,15 @@ protected:
     void showDialog(QWidget *widget);
 
 private:
+    typedef QVector< QPair<int, QVariant> > PropertyValues;
+    void copyPropertiesFrom(BaseDesignIntf* source, bool newItem = false);
+    PropertyValues changedProperties(ItemMode mode, bool reported);
+    void writeProperties(const PropertyValues& values);
     int resizeDirectionFlags(QPointF position);
     void moveSelectedItems(QPointF delta);
     Qt::CursorShape getPossibleCursor(int cursorFlags);
     void updatePossibleDirectionFlags();
+    BaseDesignIntf* findChildByName(const QString& name);
 
 private slots:
     void onChangeGeometryTimeOut();
@@ -495,6 +508,8 @@ private:
     bool     m_isChangingPos;
     bool     m_isMoveable;
     bool    m_shadow;
+    QHash<QString, QPointer<BaseDesignIntf> > m_childrenByName;
+    int     m_propertiesRevision;
 
 signals:
     void geometryChanged(QObject* object, QRectF newGeometry, QRectF oldGeometry);
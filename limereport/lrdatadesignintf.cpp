@@ -32,10 +32,18 @@
 #include <QSqlQueryModel>
 #include <QSqlRecord>
 #include <QSqlError>
+#include <QAtomicInt>
 #include <stdexcept>
+#include <algorithm>
 #include <QStringList>
 #include "lrdatasourcemanager.h"
 
+#if QT_VERSION < QT_VERSION_CHECK(5, 15, 1)
+#include <QRegExp>
+#else
+#include <QRegularExpression>
+#endif
+
 namespace LimeReport{
 
 ModelHolder::ModelHolder(QAbstractItemModel *model, bool owned /*false*/)
@@ -141,16 +149,21 @@ void QueryHolder::setDatasource(IDataSource::Ptr value){
 void QueryHolder::fillParams(QSqlQuery *query)
 {
     foreach(QString param,m_aliasesToParam.keys()){
-        QVariant value;
-        if (param.contains(".")){
-            value = dataManager()->fieldData(m_aliasesToParam.value(param));
-            param=param.right(param.length()-param.indexOf('.')-1);
-        } else {
-            value = dataManager()->variable(m_aliasesToParam.value(param));
-        }
-        if (value.isValid() || m_mode == IDataSource::DESIGN_MODE)
-            query->bindValue(':'+param,value);
+        bindParam(query, param);
+    }
+}
+
+void QueryHolder::bindParam(QSqlQuery *query, QString param)
+{
+    QVariant value;
+    if (param.contains(".")){
+        value = dataManager()->fieldData(m_aliasesToParam.value(param));
+        param=param.right(param.length()-param.indexOf('.')-1);
+    } else {
+        value = dataManager()->variable(m_aliasesToParam.value(param));
     }
+    if (value.isValid() || m_mode == IDataSource::DESIGN_MODE)
+        query->bindValue(':'+param,value);
 }
 
 void QueryHolder::extractParams()
@@ -188,10 +201,83 @@ IDataSource* QueryHolder::dataSource(IDataSource::DatasourceMode mode)
 
 // QueryHolder
 
+// ColumnsIndex
+
+QString ColumnsIndex::columnName(const QAbstractItemModel *model, int column)
+{
+    QVariant userName = model->headerData(column, Qt::Horizontal, Qt::UserRole);
+    return userName.isValid() ? userName.toString() : model->headerData(column, Qt::Horizontal).toString();
+}
+
+void ColumnsIndex::build(const QAbstractItemModel *model)
+{
+    m_indexes.clear();
+    if (model){
+        for (int i = 0; i < model->columnCount(); ++i)
+            addColumn(columnName(model, i), i);
+    }
+    m_valid = true;
+}
+
+void ColumnsIndex::build(const QVector<QString> &columnNames)
+{
+    m_indexes.clear();
+    for (int i = 0; i < columnNames.size(); ++i)
+        addColumn(columnNames.at(i), i);
+    m_valid = true;
+}
+
+void ColumnsIndex::addColumn(const QString &columnName, int column)
+{
+    QString key = columnName.toCaseFolded();
+    if (!m_indexes.contains(key))
+        m_indexes.insert(key, column);
+}
+
+// KeyFieldIndex
+
+void KeyFieldIndex::insert(int keyColumn, const QVariant &keyData, int row)
+{
+    QHash<QString, int>& rows = m_rows[keyColumn];
+    QString key = keyData.toString();
+    if (!rows.contains(key)){
+        rows.insert(key, row);
+        // key text and a hash node holding the key and the row
+        m_memory += key.size() * sizeof(QChar) + sizeof(QString) + sizeof(int) + 2 * sizeof(void*);
+    }
+}
+
+int KeyFieldIndex::row(int keyColumn, const QVariant &keyData) const
+{
+    return m_rows.value(keyColumn).value(keyData.toString(), -1);
+}
+
+DataSourceStatistics KeyFieldIndex::statistics() const
+{
+    DataSourceStatistics result;
+    result.keyIndexes = m_rows.size();
+    result.keyIndexEntries = 0;
+    foreach(const QHash<QString, int>& rows, m_rows)
+        result.keyIndexEntries += rows.size();
+    result.keyIndexMemory = m_memory;
+    return result;
+}
+
 // ModelToDataSource
 
+namespace {
+
+QAtomicInt lastGeneration;
+
+int nextGeneration()
+{
+    return lastGeneration.fetchAndAddRelaxed(1) + 1;
+}
+
+}
+
 ModelToDataSource::ModelToDataSource(QAbstractItemModel* model, bool owned)
-    : QObject(), m_model(model), m_owned(owned), m_curRow(-1), m_lastError("")
+    : QObject(), m_model(model), m_owned(owned), m_curRow(-1), m_lastError(""), m_generation(nextGeneration())
 {
     Q_ASSERT(model);
     if (model){
@@ -201,6 +287,16 @@ ModelToDataSource::ModelToDataSource(QAbstractItemModel* model, bool owned)
         }
         connect(model, SIGNAL(destroyed()), this, SLOT(slotModelDestroed()));
         connect(model, SIGNAL(modelReset()), this, SIGNAL(modelStateChanged()));
+        connect(model, SIGNAL(modelReset()), this, SLOT(slotColumnsChanged()));
+        connect(model, SIGNAL(headerDataChanged(Qt::Orientation,int,int)), this, SLOT(slotColumnsChanged()));
+        connect(model, SIGNAL(columnsInserted(QModelIndex,int,int)), this, SLOT(slotColumnsChanged()));
+        connect(model, SIGNAL(columnsRemoved(QModelIndex,int,int)), this, SLOT(slotColumnsChanged()));
+        connect(model, SIGNAL(columnsMoved(QModelIndex,int,int,QModelIndex,int)), this, SLOT(slotColumnsChanged()));
+        connect(model, SIGNAL(layoutChanged()), this, SLOT(slotRowsChanged()));
+        connect(model, SIGNAL(dataChanged(QModelIndex,QModelIndex)), this, SLOT(slotRowsChanged()));
+        connect(model, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(slotRowsChanged()));
+        connect(model, SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SLOT(slotRowsChanged()));
+        connect(model, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)), this, SLOT(slotRowsChanged()));
     }
 }
 
@@ -265,6 +361,12 @@ QVariant ModelToDataSource::data(const QString &columnName)
     return m_model->data(m_model->index(currentRow(),columnIndexByName(columnName)));
 }
 
+QVariant ModelToDataSource::dataByColumnIndex(int columnIndex)
+{
+    if (isInvalid()) return QVariant();
+    return m_model->data(m_model->index(currentRow(),columnIndex));
+}
+
 QVariant ModelToDataSource::dataByRowIndex(const QString &columnName, int rowIndex)
 {
     if (m_model->rowCount() > rowIndex)
@@ -292,12 +394,22 @@ QVariant ModelToDataSource::dataByRowIndex(const QString &columnName, int rowInd
 
 QVariant ModelToDataSource::dataByKeyField(const QString& columnName, const QString& keyColumnName, QVariant keyData)
 {
-   for( int i=0; i < m_model->rowCount(); ++i ){
-      if (m_model->data(m_model->index(i, columnIndexByName(keyColumnName))) == keyData){
-          return m_model->data(m_model->index(i, columnIndexByName(columnName)));
-      }
-   }
-   return QVariant();
+    if (isInvalid()) return QVariant();
+    int keyColumn = columnIndexByName(keyColumnName);
+    if (!m_keyFieldIndex.contains(keyColumn)){
+        m_keyFieldIndex.addColumn(keyColumn);
+        for (int i = 0; i < m_model->rowCount(); ++i)
+            m_keyFieldIndex.insert(keyColumn, m_model->data(m_model->index(i, keyColumn)), i);
+    }
+    int row = m_keyFieldIndex.row(keyColumn, keyData);
+    if (row == -1) return QVariant();
+    // keys are indexed by their text, values with the same text but another type
+    // have to be skipped until the one equal to keyData
+    for (; row < m_model->rowCount(); ++row){
+        if (m_model->data(m_model->index(row, keyColumn)) == keyData)
+            return m_model->data(m_model->index(row, columnIndexByName(columnName)));
+    }
+    return QVariant();
 }
 
 int ModelToDataSource::columnCount()
@@ -309,23 +421,15 @@ int ModelToDataSource::columnCount()
 QString ModelToDataSource::columnNameByIndex(int columnIndex)
 {
     if (isInvalid()) return "";
-    QString result = m_model->headerData(columnIndex,Qt::Horizontal, Qt::UserRole).isValid()?
-                     m_model->headerData(columnIndex,Qt::Horizontal, Qt::UserRole).toString():
-                     m_model->headerData(columnIndex,Qt::Horizontal).toString();
-    return  result;
+    return ColumnsIndex::columnName(m_model, columnIndex);
 }
 
 int ModelToDataSource::columnIndexByName(QString name)
 {
     if (isInvalid()) return 0;
-    for(int i=0;i<m_model->columnCount();i++){
-        QString columnName = m_model->headerData(i,Qt::Horizontal, Qt::UserRole).isValid()?
-                    m_model->headerData(i,Qt::Horizontal, Qt::UserRole).toString():
-                    m_model->headerData(i,Qt::Horizontal).toString();
-        if (columnName.compare(name,Qt::CaseInsensitive)==0)
-            return i;
-    }
-    return -1;
+    if (!m_columnsIndex.isValid())
+        m_columnsIndex.build(m_model);
+    return m_columnsIndex.indexOf(name);
 }
 
 QVariant ModelToDataSource::headerData(const QString &columnName, const QString &roleName)
@@ -357,9 +461,25 @@ bool ModelToDataSource::isInvalid() const
     return m_model==0;
 }
 
+void ModelToDataSource::slotColumnsChanged()
+{
+    m_columnsIndex.clear();
+    m_keyFieldIndex.clear();
+    m_generation = nextGeneration();
+}
+
+void ModelToDataSource::slotRowsChanged()
+{
+    m_keyFieldIndex.clear();
+    m_generation = nextGeneration();
+}
+
 void ModelToDataSource::slotModelDestroed()
 {
+    m_columnsIndex.clear();
+    m_keyFieldIndex.clear();
     m_model = 0;
+    m_generation = nextGeneration();
     m_lastError = tr("model is destroyed");
     emit modelStateChanged();
 }
@@ -432,9 +552,209 @@ QueryDesc::QueryDesc(QString queryName, QString queryText, QString connection)
 {}
 
 SubQueryHolder::SubQueryHolder(QString queryText, QString connectionName, QString masterDatasource, DataSourceManager* dataManager)
-    : QueryHolder(queryText, connectionName, dataManager), m_masterDatasource(masterDatasource)/*, m_invalid(false)*/
+    : QueryHolder(queryText, connectionName, dataManager), m_masterDatasource(masterDatasource)/*, m_invalid(false)*/,
+      m_batchSize(0), m_executedQueries(0)
+{
+    extractParams();
+}
+
+bool SubQueryHolder::runQuery(IDataSource::DatasourceMode mode)
+{
+    if (m_batchSize > 1 && mode == IDataSource::RENDER_MODE && runBatchedQuery())
+        return true;
+    ++m_executedQueries;
+    if (!QueryHolder::runQuery(mode)) return false;
+    m_datasourceModel.clear();
+    return true;
+}
+
+void SubQueryHolder::invalidate(IDataSource::DatasourceMode mode, bool dbWillBeClosed)
+{
+    clearBatch();
+    QueryHolder::invalidate(mode, dbWillBeClosed);
+}
+
+void SubQueryHolder::setBatchSize(int value)
+{
+    m_batchSize = value;
+    clearBatch();
+}
+
+void SubQueryHolder::clearBatch()
+{
+    m_batch = QueryBatch();
+}
+
+bool SubQueryHolder::runBatchedQuery()
+{
+    if (m_batch.disabled) return false;
+    ModelToDataSource* master = dynamic_cast<ModelToDataSource*>(dataManager()->dataSource(m_masterDatasource));
+    if (!master || master->isInvalid()) return false;
+
+    // The batch is fetched again when the master rows could have changed, and for
+    // a key which is not in it; a master proxy keeps its model for every row of
+    // its own master and is only reset
+    int masterRow = master->currentRow();
+    QVariant key = m_batch.model ? dataManager()->fieldData(m_batch.field) : QVariant();
+    if (!m_batch.model || m_batch.masterGeneration != master->generation() ||
+        masterRow < m_batch.firstRow || masterRow >= m_batch.lastRow ||
+        (!key.isNull() && !m_batch.keys.contains(key.toString())))
+    {
+        if (!prepareBatchSQL()){
+            m_batch.disabled = true;
+            return false;
+        }
+        int masterColumn = master->columnIndexByName(dataManager()->extractFieldName(m_batch.field));
+        if (masterColumn == -1 || !fetchBatch(master->model(), masterColumn, masterRow)){
+            m_batch.disabled = true;
+            return false;
+        }
+        m_batch.masterGeneration = master->generation();
+        key = dataManager()->fieldData(m_batch.field);
+    }
+
+    RowsProxyModel* rows = new RowsProxyModel();
+    rows->setSourceModel(m_batch.model.data());
+    if (!key.isNull())
+        rows->setRows(m_batch.rows.value(key.toString()));
+    setDatasource(IDataSource::Ptr(new ModelToDataSource(rows, true)));
+    // the rows of the datasource stay alive when the batch is cleared
+    m_datasourceModel = m_batch.model;
+    setMode(IDataSource::RENDER_MODE);
+    setLastError("");
+    return true;
+}
+
+bool SubQueryHolder::isBatchableSQL(QString sql, int conditionPos)
+{
+    // The rows of a block are the union of the rows of its keys only for a plain
+    // select filtered by the key condition in its WHERE clause. Limits, other
+    // condition branches, grouping and aggregates work on the whole block.
+    // Quoted literals are removed first, the keywords inside them don't matter.
+#if QT_VERSION < QT_VERSION_CHECK(5, 15, 1)
+    QString head = sql.left(conditionPos);
+    sql.replace(QRegExp("'[^']*'"), "''");
+    head.replace(QRegExp("'[^']*'"), "''");
+    QRegExp selectRx("\\bselect\\b", Qt::CaseInsensitive);
+    QRegExp whereRx("\\bwhere\\b", Qt::CaseInsensitive);
+    QRegExp unsupportedRx(Const::UNBATCHABLE_SQL_RX, Qt::CaseInsensitive);
+#else
+    QString head = sql.left(conditionPos);
+    sql.replace(QRegularExpression("'[^']*'"), "''");
+    head.replace(QRegularExpression("'[^']*'"), "''");
+    QRegularExpression selectRx("\\bselect\\b", QRegularExpression::CaseInsensitiveOption);
+    QRegularExpression whereRx("\\bwhere\\b", QRegularExpression::CaseInsensitiveOption);
+    QRegularExpression unsupportedRx(Const::UNBATCHABLE_SQL_RX, QRegularExpression::CaseInsensitiveOption);
+#endif
+    return sql.count(selectRx) == 1 && head.count(whereRx) == 1 && !sql.contains(unsupportedRx);
+}
+
+bool SubQueryHolder::prepareBatchSQL()
 {
+    // aliases of previous runs would look like more master fields
+    m_aliasesToParam.clear();
     extractParams();
+    if (!isPrepared()) return false;
+
+    QString param;
+    foreach(QString alias, m_aliasesToParam.keys()){
+        if (!alias.contains('.')) continue;
+        QString field = m_aliasesToParam.value(alias);
+        if (dataManager()->extractDataSource(field).compare(m_masterDatasource, Qt::CaseInsensitive) != 0)
+            continue;
+        // several master fields would need a list of tuples instead of IN
+        if (!param.isEmpty()) return false;
+        param = alias;
+    }
+    if (param.isEmpty()) return false;
+
+    // only "column = :param" can be turned into "column IN (...)"
+    QString placeholder = ":" + extractField(param);
+    if (m_preparedSQL.count(placeholder) != 1) return false;
+    QString detailColumn;
+    int conditionPos = -1;
+#if QT_VERSION < QT_VERSION_CHECK(5, 15, 1)
+    QRegExp rx("([\\w\\.\"`\\[\\]]+)\\s*=\\s*" + QRegExp::escape(placeholder) + "(?!\\w)");
+    conditionPos = rx.indexIn(m_preparedSQL);
+    if (conditionPos == -1) return false;
+    detailColumn = rx.cap(1);
+    m_batch.sqlHead = m_preparedSQL.left(conditionPos) + detailColumn + " IN (";
+    m_batch.sqlTail = ")" + m_preparedSQL.mid(conditionPos + rx.matchedLength());
+#else
+    QRegularExpression rx("([\\w\\.\"`\\[\\]]+)\\s*=\\s*" + QRegularExpression::escape(placeholder) + "(?!\\w)");
+    QRegularExpressionMatch match = rx.match(m_preparedSQL);
+    if (!match.hasMatch()) return false;
+    conditionPos = match.capturedStart();
+    detailColumn = match.captured(1);
+    m_batch.sqlHead = m_preparedSQL.left(conditionPos) + detailColumn + " IN (";
+    m_batch.sqlTail = ")" + m_preparedSQL.mid(match.capturedEnd());
+#endif
+    if (!isBatchableSQL(m_preparedSQL, conditionPos)) return false;
+    detailColumn = detailColumn.mid(detailColumn.lastIndexOf('.') + 1);
+    detailColumn.remove('"');
+    detailColumn.remove('`');
+    detailColumn.remove('[');
+    detailColumn.remove(']');
+
+    m_batch.param = param;
+    m_batch.field = m_aliasesToParam.value(param);
+    m_batch.detailColumn = detailColumn;
+    return true;
+}
+
+bool SubQueryHolder::fetchBatch(QAbstractItemModel *master, int masterColumn, int masterRow)
+{
+    QSqlDatabase db = QSqlDatabase::database(connectionName());
+    if (!db.isValid()) return false;
+
+    int lastRow = qMin(masterRow + m_batchSize, master->rowCount());
+    QVector<QVariant> keys;
+    m_batch.keys.clear();
+    for (int row = masterRow; row < lastRow; ++row){
+        QVariant key = master->data(master->index(row, masterColumn));
+        if (key.isNull() || m_batch.keys.contains(key.toString())) continue;
+        m_batch.keys.insert(key.toString());
+        keys.append(key);
+    }
+
+    QStringList placeholders;
+    for (int i = 0; i < keys.count(); ++i)
+        placeholders.append(QString(":%1_batch%2").arg(extractField(m_batch.param)).arg(i));
+
+    QSqlQuery query(db);
+    // "IN (NULL)" still gives the columns of the detail query for a block without keys
+    query.prepare(m_batch.sqlHead + (placeholders.isEmpty() ? QString("NULL") : placeholders.join(", ")) + m_batch.sqlTail);
+    foreach(QString param, m_aliasesToParam.keys()){
+        if (param != m_batch.param)
+            bindParam(&query, param);
+    }
+    for (int i = 0; i < keys.count(); ++i)
+        query.bindValue(placeholders.at(i), keys.at(i));
+    ++m_executedQueries;
+    query.exec();
+
+    QSharedPointer<QSqlQueryModel> model(new QSqlQueryModel);
+#if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
+    model->setQuery(std::move(query));
+#else
+    model->setQuery(query);
+#endif
+    while (model->canFetchMore())
+        model->fetchMore();
+    if (model->lastError().isValid()) return false;
+
+    ColumnsIndex columns;
+    columns.build(model.data());
+    int detailColumn = columns.indexOf(m_batch.detailColumn);
+    if (detailColumn == -1) return false;
+
+    m_batch.rows.clear();
+    for (int row = 0; row < model->rowCount(); ++row)
+        m_batch.rows[model->data(model->index(row, detailColumn)).toString()].append(row);
+    m_batch.model = model;
+    m_batch.firstRow = masterRow;
+    m_batch.lastRow = lastRow;
+    return true;
 }
 
 void SubQueryHolder::setMasterDatasource(const QString &value)
@@ -469,7 +789,7 @@ QString SubQueryHolder::replaceFields(QString query)
 }
 
 SubQueryDesc::SubQueryDesc(QString queryName, QString queryText, QString connection, QString masterDatasourceName)
-    :QueryDesc(queryName,queryText,connection), m_masterDatasourceName(masterDatasourceName)
+    :QueryDesc(queryName,queryText,connection), m_masterDatasourceName(masterDatasourceName), m_batchSize(0)
 {
 }
 
@@ -575,6 +895,103 @@ void ProxyDesc::addFieldsCorrelation(const FieldsCorrelation& fieldsCorrelation)
     m_maps.append(new FieldMapDesc(fieldsCorrelation));
 }
 
+void RowsProxyModel::setSourceModel(QAbstractItemModel *sourceModel)
+{
+    beginResetModel();
+    QAbstractProxyModel::setSourceModel(sourceModel);
+    m_rows.clear();
+    endResetModel();
+}
+
+void RowsProxyModel::setRows(const QVector<int> &rows)
+{
+    beginResetModel();
+    m_rows = rows;
+    endResetModel();
+}
+
+QModelIndex RowsProxyModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (parent.isValid() || row < 0 || column < 0 || row >= rowCount() || column >= columnCount())
+        return QModelIndex();
+    return createIndex(row, column);
+}
+
+QModelIndex RowsProxyModel::parent(const QModelIndex &child) const
+{
+    Q_UNUSED(child)
+    return QModelIndex();
+}
+
+int RowsProxyModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) return 0;
+    return rows().size();
+}
+
+int RowsProxyModel::columnCount(const QModelIndex &parent) const
+{
+    if (parent.isValid() || !sourceModel()) return 0;
+    return sourceModel()->columnCount();
+}
+
+QModelIndex RowsProxyModel::mapToSource(const QModelIndex &proxyIndex) const
+{
+    if (!proxyIndex.isValid() || !sourceModel() || proxyIndex.row() >= rows().size())
+        return QModelIndex();
+    return sourceModel()->index(rows().at(proxyIndex.row()), proxyIndex.column());
+}
+
+QModelIndex RowsProxyModel::mapFromSource(const QModelIndex &sourceIndex) const
+{
+    if (!sourceIndex.isValid()) return QModelIndex();
+    const QVector<int>& proxyRows = rows();
+    QVector<int>::const_iterator it = std::lower_bound(proxyRows.constBegin(), proxyRows.constEnd(), sourceIndex.row());
+    if (it == proxyRows.constEnd() || *it != sourceIndex.row()) return QModelIndex();
+    return createIndex(int(it - proxyRows.constBegin()), sourceIndex.column());
+}
+
+QVariant RowsProxyModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation == Qt::Horizontal)
+        return sourceModel() ? sourceModel()->headerData(section, orientation, role) : QVariant();
+    return QAbstractProxyModel::headerData(section, orientation, role);
+}
+
+MasterDetailProxyModel::MasterDetailProxyModel(DataSourceManager *dataManager)
+    : m_maps(0), m_dataManager(dataManager), m_partitionsValid(false), m_rowsValid(false)
+{}
+
+void MasterDetailProxyModel::setSourceModel(QAbstractItemModel *sourceModel)
+{
+    if (this->sourceModel())
+        disconnect(this->sourceModel(), 0, this, 0);
+    m_columnsIndex.clear();
+    m_partitionsValid = false;
+    m_rowsValid = false;
+    RowsProxyModel::setSourceModel(sourceModel);
+    if (sourceModel){
+        connect(sourceModel, SIGNAL(modelReset()), this, SLOT(slotSourceChanged()));
+        connect(sourceModel, SIGNAL(layoutChanged()), this, SLOT(slotSourceChanged()));
+        connect(sourceModel, SIGNAL(dataChanged(QModelIndex,QModelIndex)), this, SLOT(slotSourceChanged()));
+        connect(sourceModel, SIGNAL(headerDataChanged(Qt::Orientation,int,int)), this, SLOT(slotSourceChanged()));
+        connect(sourceModel, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(slotSourceChanged()));
+        connect(sourceModel, SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SLOT(slotSourceChanged()));
+        connect(sourceModel, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)), this, SLOT(slotSourceChanged()));
+        connect(sourceModel, SIGNAL(columnsInserted(QModelIndex,int,int)), this, SLOT(slotSourceChanged()));
+        connect(sourceModel, SIGNAL(columnsRemoved(QModelIndex,int,int)), this, SLOT(slotSourceChanged()));
+        connect(sourceModel, SIGNAL(columnsMoved(QModelIndex,int,int,QModelIndex,int)), this, SLOT(slotSourceChanged()));
+    }
+}
+
+void MasterDetailProxyModel::slotSourceChanged()
+{
+    m_columnsIndex.clear();
+    m_partitionsValid = false;
+    m_rowsValid = false;
+    setRows(QVector<int>());
+}
+
 void MasterDetailProxyModel::setMaster(QString name){
     m_masterName=name;
 }
@@ -588,41 +1005,69 @@ bool MasterDetailProxyModel::isInvalid() const
     return masterData->isInvalid() || childData->isInvalid();
 }
 
-bool MasterDetailProxyModel::filterAcceptsRow(int source_row, const QModelIndex &source_parent) const
+void MasterDetailProxyModel::invalidate()
 {
-    Q_UNUSED(source_parent)
-    foreach (FieldMapDesc* fieldCorrelation, *m_maps) {
-        QVariant master = masterData(fieldCorrelation->master());
-        QVariant detail = sourceData(fieldCorrelation->detail(),source_row);
-        if (master==detail)
-            return true;
+    QVector<int> rows = acceptedRows();
+    m_rowsValid = true;
+    setRows(rows);
+}
+
+const QVector<int>& MasterDetailProxyModel::rows() const
+{
+    if (!m_rowsValid){
+        m_rows = acceptedRows();
+        m_rowsValid = true;
     }
-    return false;
+    return m_rows;
 }
 
-int MasterDetailProxyModel::fieldIndexByName(QString fieldName) const
+void MasterDetailProxyModel::buildPartitions() const
 {
-    for(int i=0;i<sourceModel()->columnCount();++i){
-        QString sourceFieldName = sourceModel()->headerData(i,Qt::Horizontal,Qt::UserRole).isValid()?
-                            sourceModel()->headerData(i,Qt::Horizontal,Qt::UserRole).toString():
-                            sourceModel()->headerData(i,Qt::Horizontal).toString();
-        if (sourceFieldName.compare(fieldName,Qt::CaseInsensitive)==0){
-           return i;
+    m_partitions.clear();
+    m_detailColumns.clear();
+    int rowCount = sourceModel()->rowCount();
+    foreach (FieldMapDesc* fieldCorrelation, *m_maps) {
+        int column = fieldIndexByName(fieldCorrelation->detail());
+        if (column == -1 && rowCount > 0)
+            throw ReportError(
+                tr("Field: \"%1\" not found in \"%2\" child datasource").arg(fieldCorrelation->detail()).arg(m_childName)
+            );
+        Partition partition;
+        for (int row = 0; row < rowCount; ++row)
+            partition[sourceModel()->index(row, column).data().toString()].append(row);
+        m_partitions.append(partition);
+        m_detailColumns.append(column);
+    }
+    m_partitionsValid = true;
+}
+
+QVector<int> MasterDetailProxyModel::acceptedRows() const
+{
+    QVector<int> result;
+    if (!m_maps || !sourceModel()) return result;
+    if (!m_partitionsValid || m_partitions.size() != m_maps->size())
+        buildPartitions();
+    // a child row is accepted when any of the correlations matches,
+    // rows sharing the text of the master value are compared as before
+    for (int i = 0; i < m_maps->size(); ++i){
+        QVariant master = masterData(m_maps->at(i)->master());
+        foreach (int row, m_partitions.at(i).value(master.toString())){
+            if (sourceModel()->index(row, m_detailColumns.at(i)).data() == master)
+                result.append(row);
         }
     }
-    return -1;
+    if (m_maps->size() > 1){
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+    }
+    return result;
 }
 
-QVariant MasterDetailProxyModel::sourceData(QString fieldName, int row) const
+int MasterDetailProxyModel::fieldIndexByName(QString fieldName) const
 {
-    int fieldIndex = fieldIndexByName(fieldName);
-    if (fieldIndex!=-1){
-        return sourceModel()->index(row,fieldIndex).data();
-    } else {
-        throw ReportError(
-            tr("Field: \"%1\" not found in \"%2\" child datasource").arg(fieldName).arg(m_childName)
-        );
-    }
+    if (!m_columnsIndex.isValid())
+        m_columnsIndex.build(sourceModel());
+    return m_columnsIndex.indexOf(fieldName);
 }
 
 QVariant MasterDetailProxyModel::masterData(QString fieldName) const
@@ -691,6 +1136,7 @@ bool CallbackDatasource::prior(){
 }
 
 void CallbackDatasource::first(){
+    int oldRowCount = m_rowCount;
     m_currentRow = 0;
     m_getDataFromCache = false;
     m_eof=checkIfEmpty();
@@ -705,6 +1151,23 @@ void CallbackDatasource::first(){
     emit changePos(CallbackInfo::First,result);
     if (m_rowCount>0) m_eof = false;
     else m_eof = !result;
+    // the rows read for the key index are only dropped when the data changes
+    if (m_rowCount != oldRowCount)
+        invalidateKeyIndex();
+}
+
+void CallbackDatasource::invalidateKeyIndex()
+{
+    m_keyFieldIndex.clear();
+    m_keyRows.clear();
+    m_keyRowsValid = false;
+    m_lastKeyRow = 0;
+}
+
+void CallbackDatasource::setMaxKeyIndexRows(int value)
+{
+    m_maxKeyIndexRows = value;
+    invalidateKeyIndex();
 }
 
 QVariant CallbackDatasource::callbackData(const QString& columnName, int row)
@@ -761,6 +1224,29 @@ QVariant CallbackDatasource::dataByRowIndex(const QString &columnName, int rowIn
 
 QVariant CallbackDatasource::dataByKeyField(const QString& columnName, const QString& keyColumnName, QVariant keyData)
 {
+    int keyColumn = columnIndexByName(keyColumnName);
+    int column = columnIndexByName(columnName);
+    if (!m_keyRowsValid && keyColumn != -1 && column != -1)
+        buildKeyRows();
+    if (!m_keyRows.isEmpty() && keyColumn != -1 && column != -1){
+        if (!m_keyFieldIndex.contains(keyColumn)){
+            m_keyFieldIndex.addColumn(keyColumn);
+            for (int i = 0; i < m_keyRows.size(); ++i)
+                m_keyFieldIndex.insert(keyColumn, m_keyRows.at(i).at(keyColumn), i);
+        }
+        int row = m_keyFieldIndex.row(keyColumn, keyData);
+        if (row == -1) return QVariant();
+        for (; row < m_keyRows.size(); ++row){
+            if (m_keyRows.at(row).at(keyColumn) == keyData){
+                m_lastKeyRow = row;
+                return m_keyRows.at(row).at(column);
+            }
+        }
+        return QVariant();
+    }
+
+    // columns are not known or there are too many rows to keep them,
+    // rows are searched starting after the last found one
     int backupCurrentRow = m_currentRow;
     QVariant result = QVariant();
 
@@ -795,9 +1281,45 @@ QVariant CallbackDatasource::dataByKeyField(const QString& columnName, const QSt
     return result;
 }
 
+void CallbackDatasource::buildKeyRows()
+{
+    // the callback may read the current row only, so the rows are walked through
+    // and are kept only while there are not more of them than m_maxKeyIndexRows
+    int backupCurrentRow = m_currentRow;
+    bool backupEof = m_eof;
+    invalidateKeyIndex();
+    first();
+    if (!eof()){
+        do {
+            if (m_keyRows.size() == m_maxKeyIndexRows){
+                m_keyRows.clear();
+                break;
+            }
+            QVector<QVariant> values;
+            values.reserve(m_headers.size());
+            for (int i = 0; i < m_headers.size(); ++i)
+                values.append(callbackData(m_headers.at(i), m_currentRow));
+            m_keyRows.append(values);
+        } while (next());
+    }
+    m_keyRowsValid = true;
+    m_currentRow = backupCurrentRow;
+    m_eof = backupEof;
+}
+
+DataSourceStatistics CallbackDatasource::statistics() const
+{
+    DataSourceStatistics result = m_keyFieldIndex.statistics();
+    foreach(const QVector<QVariant>& values, m_keyRows)
+        result.keyIndexMemory += sizeof(QVector<QVariant>) + values.size() * sizeof(QVariant);
+    return result;
+}
+
 int CallbackDatasource::columnCount(){
     CallbackInfo info;
     if (m_columnCount == -1){
+        m_columnsIndex.clear();
+        invalidateKeyIndex();
         QVariant columnCount;
         info.dataType = CallbackInfo::ColumnCount;
         emit getCallbackData(info,columnCount);
@@ -840,17 +1362,9 @@ QString CallbackDatasource::columnNameByIndex(int columnIndex)
 
 int CallbackDatasource::columnIndexByName(QString name)
 {
-    for (int i=0;i<m_headers.size();++i) {
-        if (m_headers[i].compare(name, Qt::CaseInsensitive) == 0)
-            return i;
-    }
-//    if (m_headers.size()==0){
-//        QVariant data;
-//        bool hasNextRow;
-//        emit getData(m_currentRow, name, data, hasNextRow);
-//        if (data.isValid()) return 0;
-//    }
-    return -1;
+    if (!m_columnsIndex.isValid())
+        m_columnsIndex.build(m_headers);
+    return m_columnsIndex.indexOf(name);
 }
 
 QVariant CallbackDatasource::headerData(const QString &columnName, const QString &roleName)
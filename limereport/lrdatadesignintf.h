@@ -37,12 +37,17 @@
 #include <QtSql/QSqlQuery>
 #include <QDebug>
 #include <QSharedPointer>
+#include <QSet>
 #include <QSortFilterProxyModel>
+#include <QAbstractProxyModel>
 #include <QVariant>
 #include "lrcollection.h"
+#include "lrglobal.h"
 #include "lrcallbackdatasourceintf.h"
 #include "lrdatasourceintf.h"
 
+class QSqlQueryModel;
+
 namespace LimeReport{
 
 class DataSourceManager;
@@ -236,7 +241,9 @@ public:
 protected:
     void setDatasource(IDataSource::Ptr value);
     void setPrepared(bool prepared){ m_prepared = prepared;}
+    void setMode(IDataSource::DatasourceMode mode){ m_mode = mode;}
     virtual void fillParams(QSqlQuery* query);
+    void bindParam(QSqlQuery* query, QString param);
     virtual void extractParams();
     QString replaceVariables(QString query);
     QMap<QString,QString> m_aliasesToParam;
@@ -254,13 +261,21 @@ private:
 class SubQueryDesc : public QueryDesc{
     Q_OBJECT
     Q_PROPERTY(QString master READ master WRITE setMaster)
+    // Number of master rows whose detail rows are fetched by one query, 0 runs the
+    // query for every master row. Batched rows are matched to a master row by the
+    // exact text of the key, so keys which are only equal under a case insensitive
+    // or padded collation, or by the type affinity of the database, find no rows.
+    Q_PROPERTY(int batchSize READ batchSize WRITE setBatchSize)
 public:
     SubQueryDesc(QString queryName, QString queryText, QString connection, QString master);
-    explicit SubQueryDesc(QObject* parent=0):QueryDesc(parent){}
+    explicit SubQueryDesc(QObject* parent=0):QueryDesc(parent), m_batchSize(0){}
     void setMaster(QString value){m_masterDatasourceName=value;}
     QString master(){return m_masterDatasourceName;}
+    int batchSize() const {return m_batchSize;}
+    void setBatchSize(int value){m_batchSize=value;}
 private:
     QString m_masterDatasourceName;
+    int m_batchSize;
 };
 
 class SubQueryHolder:public QueryHolder{
@@ -270,13 +285,46 @@ public:
     void setMasterDatasource(const QString& value);
     //void invalidate(){m_invalid = true;}
     bool isInvalid() const{ return QueryHolder::isInvalid(); /*|| m_invalid;*/}
+    bool runQuery(IDataSource::DatasourceMode mode = IDataSource::RENDER_MODE);
+    void invalidate(IDataSource::DatasourceMode mode, bool dbWillBeClosed = false);
+    int batchSize() const {return m_batchSize;}
+    void setBatchSize(int value);
+    void clearBatch();
+    // detail queries run so far, one for every master row or for every batch
+    int executedQueries() const {return m_executedQueries;}
 protected:
     void extractParams();
     QString extractField(QString source);
     QString replaceFields(QString query);
+private:
+    // Detail rows of a block of master rows fetched by one query,
+    // grouped by the text of the correlated detail column
+    struct QueryBatch{
+        QueryBatch(): masterGeneration(0), firstRow(0), lastRow(0), disabled(false){}
+        QString param;
+        QString field;
+        QString sqlHead;
+        QString sqlTail;
+        QString detailColumn;
+        QSharedPointer<QSqlQueryModel> model;
+        int masterGeneration;
+        int firstRow;
+        int lastRow;
+        QHash<QString, QVector<int> > rows;
+        QSet<QString> keys;
+        bool disabled;
+    };
+    bool runBatchedQuery();
+    bool prepareBatchSQL();
+    static bool isBatchableSQL(QString sql, int conditionPos);
+    bool fetchBatch(QAbstractItemModel* master, int masterColumn, int masterRow);
 private:
     QString m_masterDatasource;
     //bool m_invalid;
+    int m_batchSize;
+    int m_executedQueries;
+    QueryBatch m_batch;
+    QSharedPointer<QSqlQueryModel> m_datasourceModel;
 };
 
 struct FieldsCorrelation{
@@ -325,25 +373,94 @@ private:
     QString m_name;
 };
 
-class MasterDetailProxyModel : public QSortFilterProxyModel{    
+// Case insensitive map of column names to column indexes,
+// the first column wins if names are repeated
+class ColumnsIndex{
+public:
+    ColumnsIndex(): m_valid(false){}
+    bool isValid() const {return m_valid;}
+    void clear(){m_indexes.clear(); m_valid = false;}
+    void build(const QAbstractItemModel* model);
+    void build(const QVector<QString>& columnNames);
+    int indexOf(const QString& columnName) const {return m_indexes.value(columnName.toCaseFolded(), -1);}
+    static QString columnName(const QAbstractItemModel* model, int column);
+private:
+    void addColumn(const QString& columnName, int column);
+private:
+    QHash<QString, int> m_indexes;
+    bool m_valid;
+};
+
+// Rows of a datasource by the text of a key column value, built on the first
+// lookup by that column; only the first row of each key is kept
+class KeyFieldIndex{
+public:
+    KeyFieldIndex(): m_memory(0){}
+    bool isEmpty() const {return m_rows.isEmpty();}
+    bool contains(int keyColumn) const {return m_rows.contains(keyColumn);}
+    void addColumn(int keyColumn){m_rows[keyColumn];}
+    void insert(int keyColumn, const QVariant& keyData, int row);
+    int row(int keyColumn, const QVariant& keyData) const;
+    void clear(){m_rows.clear(); m_memory = 0;}
+    DataSourceStatistics statistics() const;
+private:
+    QHash<int, QHash<QString, int> > m_rows;
+    qint64 m_memory;
+};
+
+// Flat proxy showing the listed rows of its source model
+class RowsProxyModel : public QAbstractProxyModel{
     Q_OBJECT
 public:
-    MasterDetailProxyModel(DataSourceManager* dataManager):m_maps(0),m_dataManager(dataManager){}
+    explicit RowsProxyModel(QObject* parent = 0): QAbstractProxyModel(parent){}
+    void setSourceModel(QAbstractItemModel *sourceModel);
+    void setRows(const QVector<int>& rows);
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const;
+    QModelIndex parent(const QModelIndex &child) const;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    QModelIndex mapToSource(const QModelIndex &proxyIndex) const;
+    QModelIndex mapFromSource(const QModelIndex &sourceIndex) const;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+protected:
+    virtual const QVector<int>& rows() const {return m_rows;}
+    mutable QVector<int> m_rows;
+};
+
+// Child rows matching the current master row. The child rows are partitioned
+// by the text of each detail field once, so moving to another master row only
+// picks the rows of its partitions.
+class MasterDetailProxyModel : public RowsProxyModel{
+    Q_OBJECT
+public:
+    MasterDetailProxyModel(DataSourceManager* dataManager);
+    void setSourceModel(QAbstractItemModel *sourceModel);
     void setMaster(QString name);
     void setChildName(QString name){m_childName=name;}
-    void setFieldsMap(QList<FieldMapDesc*> *fieldsMap){m_maps=fieldsMap;}
+    void setFieldsMap(QList<FieldMapDesc*> *fieldsMap){m_maps=fieldsMap; m_partitionsValid = false;}
     bool isInvalid() const;
     DataSourceManager* dataManager() const {return m_dataManager;}
+    void invalidate();
 protected:
-    bool filterAcceptsRow(int source_row, const QModelIndex &source_parent) const;
+    const QVector<int>& rows() const;
     int fieldIndexByName(QString fieldName) const;
-    QVariant sourceData(QString fieldName, int row) const;
     QVariant masterData(QString fieldName) const;
+private slots:
+    void slotSourceChanged();
+private:
+    typedef QHash<QString, QVector<int> > Partition;
+    void buildPartitions() const;
+    QVector<int> acceptedRows() const;
 private:
     QList<FieldMapDesc*>* m_maps;
     QString m_masterName;
     QString m_childName;
     DataSourceManager* m_dataManager;
+    mutable ColumnsIndex m_columnsIndex;
+    mutable QVector<Partition> m_partitions;
+    mutable QVector<int> m_detailColumns;
+    mutable bool m_partitionsValid;
+    mutable bool m_rowsValid;
 };
 
 class ProxyHolder: public QObject, public IDataSourceHolder{
@@ -387,6 +504,7 @@ public:
     bool eof();
     bool bof();
     QVariant data(const QString& columnName);
+    QVariant dataByColumnIndex(int columnIndex);
     QVariant dataByRowIndex(const QString &columnName, int rowIndex);
     QVariant dataByRowIndex(const QString &columnName, int rowIndex, int roleName);
     QVariant dataByRowIndex(const QString &columnName, int rowIndex, const QString &roleName);
@@ -399,22 +517,33 @@ public:
     virtual QAbstractItemModel* model();
     int currentRow();
     bool isInvalid() const;
+    DataSourceStatistics statistics() const {return m_keyFieldIndex.statistics();}
+    // changes whenever rows or columns of the model change, the numbers are taken
+    // from one counter of all datasources, so a datasource which replaced another
+    // one never has the generation the replaced one had
+    int generation() const {return m_generation;}
 signals:
     void modelStateChanged();
 private slots:
     void slotModelDestroed();
+    void slotColumnsChanged();
+    void slotRowsChanged();
 private:
     QAbstractItemModel* m_model;
     bool m_owned;
     int  m_curRow;
     QString m_lastError;
+    ColumnsIndex m_columnsIndex;
+    KeyFieldIndex m_keyFieldIndex;
+    int m_generation;
 };
 
 class CallbackDatasource :public ICallbackDatasource, public IDataSource {
     Q_OBJECT
 public:
     CallbackDatasource():  m_currentRow(-1), m_eof(false), m_columnCount(-1),
-                           m_rowCount(-1), m_getDataFromCache(false), m_lastKeyRow(0){}
+                           m_rowCount(-1), m_getDataFromCache(false), m_lastKeyRow(0),
+                           m_keyRowsValid(false), m_maxKeyIndexRows(Const::MAX_CALLBACK_KEY_INDEX_ROWS){}
     bool next();
     bool hasNext(){ if (!m_eof) return checkNextRecord(m_currentRow); else return false;}
     bool prior();
@@ -434,10 +563,16 @@ public:
     QString lastError(){ return "";}
     QAbstractItemModel *model(){return 0;}
     QVariant headerData(const QString &columnName, const QString &roleName);
+    DataSourceStatistics statistics() const;
+    // drops the rows read for dataByKeyField, the data of the callback has changed
+    void invalidateKeyIndex();
+    // datasources with more rows are searched without the index, 0 turns it off
+    void setMaxKeyIndexRows(int value);
 private:
     bool checkNextRecord(int recordNum);
     bool checkIfEmpty();
     QVariant callbackData(const QString& columnName, int row);
+    void buildKeyRows();
 private:
     QVector<QString> m_headers;
     int m_currentRow;
@@ -447,6 +582,11 @@ private:
     QHash<QString, QVariant> m_valuesCache;
     bool m_getDataFromCache;
     int m_lastKeyRow;
+    ColumnsIndex m_columnsIndex;
+    KeyFieldIndex m_keyFieldIndex;
+    QVector<QVector<QVariant> > m_keyRows;
+    bool m_keyRowsValid;
+    int m_maxKeyIndexRows;
 
 };
 
@@ -227,7 +227,7 @@ void DataSourceModel::updateModel()
 
 DataSourceManager::DataSourceManager(QObject *parent) :
     QObject(parent), m_lastError(""), m_designTime(false), m_needUpdate(false),
-    m_dbCredentialsProvider(0), m_hasChanges(false)
+    m_scriptManager(0), m_dbCredentialsProvider(0), m_fieldHandlesEpoch(0), m_hasChanges(false)
 {
     m_groupFunctionFactory.registerFunctionCreator(QLatin1String("COUNT"),new ConstructorGroupFunctionCreator<CountGroupFunction>);
     m_groupFunctionFactory.registerFunctionCreator(QLatin1String("SUM"),new ConstructorGroupFunctionCreator<SumGroupFunction>);
@@ -248,6 +248,8 @@ DataSourceManager::DataSourceManager(QObject *parent) :
             this, SLOT(slotVariableHasBeenAdded(QString)));
     connect(&m_userVariables, SIGNAL(variableHasBeenChanged(QString)),
             this, SLOT(slotVariableHasBeenChanged(QString)));
+    connect(this, SIGNAL(datasourcesChanged()),
+            this, SLOT(slotInvalidateFieldHandles()));
 
 
 }
@@ -644,6 +646,16 @@ void DataSourceManager::addSubQuery(const QString &name, const QString &sqlText,
     emit datasourcesChanged();
 }
 
+void DataSourceManager::setSubQueryBatchSize(const QString &name, int batchSize)
+{
+    SubQueryDesc* subQueryDesc = subQueryByName(name);
+    if (!subQueryDesc) return;
+    subQueryDesc->setBatchSize(batchSize);
+    SubQueryHolder* holder = dynamic_cast<SubQueryHolder*>(dataSourceHolder(name));
+    if (holder) holder->setBatchSize(batchSize);
+    m_hasChanges = true;
+}
+
 void DataSourceManager::addProxy(const QString &name, const QString &master, const QString &detail, QList<FieldsCorrelation> fields)
 {
     ProxyDesc *proxyDesc = new ProxyDesc();
@@ -784,6 +796,7 @@ void DataSourceManager::removeDatasource(const QString &name)
         IDataSourceHolder *holder;
         holder=m_datasources.value(name);
         m_datasources.remove(name);
+        slotInvalidateFieldHandles();
         delete holder;
     }
     if (isQuery(name)){
@@ -871,6 +884,7 @@ void DataSourceManager::putHolder(const QString& name, IDataSourceHolder *dataSo
             name.toLower(),
             dataSource
         );
+        slotInvalidateFieldHandles();
     } else throw ReportError(tr("Datasource with name \"%1\" already exists!").arg(name));
 }
 
@@ -1121,6 +1135,7 @@ void DataSourceManager::disconnectConnection(const QString& connectionName)
             }
         }
     }
+    slotInvalidateFieldHandles();
 
     ConnectionDesc* connectionDesc = connectionByName(connectionName);
 
@@ -1156,6 +1171,19 @@ IDataSourceHolder *DataSourceManager::dataSourceHolder(const QString &name)
     else return 0;
 }
 
+DataSourceStatistics DataSourceManager::dataSourceStatistics(const QString &name)
+{
+    DataSourceStatistics result = {0, 0, 0};
+    IDataSourceHolder* holder = dataSourceHolder(name);
+    if (!holder || holder->isInvalid()) return result;
+    IDataSource* ds = holder->dataSource(designTime()?IDataSource::DESIGN_MODE:IDataSource::RENDER_MODE);
+    ModelToDataSource* modelDataSource = dynamic_cast<ModelToDataSource*>(ds);
+    if (modelDataSource) return modelDataSource->statistics();
+    CallbackDatasource* callbackDataSource = dynamic_cast<CallbackDatasource*>(ds);
+    if (callbackDataSource) return callbackDataSource->statistics();
+    return result;
+}
+
 QStringList DataSourceManager::dataSourceNames()
 {
     QStringList result;
@@ -1328,12 +1356,13 @@ void DataSourceManager::collectionLoadFinished(const QString &collectionName)
             if (!m_datasources.contains(it.value()->queryName().toLower())){
                 connect(it.value(), SIGNAL(queryTextChanged(QString,QString)),
                         this, SLOT(slotQueryTextChanged(QString,QString)));
-                putHolder(it.value()->queryName(),new SubQueryHolder(
+                SubQueryHolder* holder = new SubQueryHolder(
                               it.value()->queryText(),
                               it.value()->connectionName(),
                               it.value()->master(),
-                              this)
-                );
+                              this);
+                holder->setBatchSize(it.value()->batchSize());
+                putHolder(it.value()->queryName(), holder);
             } else {
                 delete it.value();
                 it.remove();
@@ -1479,6 +1508,7 @@ void DataSourceManager::slotQueryTextChanged(const QString &queryName, const QSt
     QueryHolder* holder = dynamic_cast<QueryHolder*>(m_datasources.value(queryName));
     if (holder){
         holder->setQueryText(queryText);
+        slotInvalidateFieldHandles();
     }
     m_varToDataSource.clear();
 }
@@ -1490,7 +1520,10 @@ void DataSourceManager::invalidateQueriesContainsVariable(const QString& variabl
         if (m_varToDataSource.contains(variableName)){
             foreach(QString datasourceName, m_varToDataSource.value(variableName)){
                 QueryHolder* holder = dynamic_cast<QueryHolder*>(m_datasources.value(datasourceName));
-                if (holder) holder->invalidate(designTime() ? IDataSource::DESIGN_MODE : IDataSource::RENDER_MODE);
+                if (holder) {
+                    holder->invalidate(designTime() ? IDataSource::DESIGN_MODE : IDataSource::RENDER_MODE);
+                    slotInvalidateFieldHandles();
+                }
             }
         } else {
             QVector<QString> datasources;
@@ -1504,6 +1537,7 @@ void DataSourceManager::invalidateQueriesContainsVariable(const QString& variabl
 #endif
                     if  (holder->queryText().contains(rx)){
                         holder->invalidate(designTime() ? IDataSource::DESIGN_MODE : IDataSource::RENDER_MODE);
+                        slotInvalidateFieldHandles();
                         datasources.append(datasourceName);
                     }
                 }
@@ -1532,12 +1566,14 @@ void DataSourceManager::slotCSVTextChanged(const QString &csvName, const QString
     CSVHolder* holder = dynamic_cast<CSVHolder*>(m_datasources.value(csvName));
     if (holder){
         holder->setCSVText(csvText);
+        slotInvalidateFieldHandles();
     }
 }
 
 void DataSourceManager::clear(ClearMethod method)
 {
     m_varToDataSource.clear();
+    slotInvalidateFieldHandles();
 
     DataSourcesMap::iterator dit;
     for( dit = m_datasources.begin(); dit != m_datasources.end(); ){
@@ -1594,7 +1630,7 @@ void DataSourceManager::clearGroupFunction()
 void DataSourceManager::clearGroupFunctionValues(const QString& bandObjectName)
 {
     foreach(GroupFunction* gf, m_groupFunctions.values(bandObjectName)){
-        gf->values().clear();
+        gf->clearValues();
     }
 }
 
@@ -1650,11 +1686,7 @@ QString DataSourceManager::extractFieldName(const QString &fieldName)
 
 bool DataSourceManager::containsField(const QString &fieldName)
 {
-    IDataSource* ds = dataSource(extractDataSource(fieldName));
-    if (ds) {
-        return ds->columnIndexByName(extractFieldName(fieldName))!=-1;
-    }
-    return false;
+    return fieldHandle(fieldName).isValid();
 }
 
 bool DataSourceManager::containsVariable(const QString& variableName)
@@ -1671,13 +1703,64 @@ void DataSourceManager::clearUserVariables()
 
 QVariant DataSourceManager::fieldData(const QString &fieldName)
 {
-    if (containsField(fieldName)){
-        IDataSource* ds = dataSource(extractDataSource(fieldName));
-        if (ds) return ds->data(extractFieldName(fieldName));
-    }
+    FieldHandle handle = fieldHandle(fieldName);
+    if (handle.isValid())
+        return handle.dataSource->dataByColumnIndex(handle.column);
+    return QVariant();
+}
+
+FieldHandle DataSourceManager::fieldHandle(const QString &fieldName)
+{
+    // the handle is copied out of the cache: validating or resolving it may run
+    // a query whose parameters are fields too
+    FieldHandle handle = m_fieldHandles.value(fieldName);
+    if (isFieldHandleValid(handle))
+        return handle;
+    handle = resolveField(fieldName);
+    if (handle.isValid())
+        m_fieldHandles.insert(fieldName, handle);
+    else
+        m_fieldHandles.remove(fieldName);
+    return handle;
+}
+
+bool DataSourceManager::isFieldHandleValid(const FieldHandle &handle)
+{
+    if (!handle.isValid() || handle.epoch != m_fieldHandlesEpoch || handle.holder->isInvalid())
+        return false;
+    return handle.holder->dataSource(designTime()?IDataSource::DESIGN_MODE:IDataSource::RENDER_MODE) == handle.dataSource;
+}
+
+QVariant DataSourceManager::fieldData(const FieldHandle &handle)
+{
+    if (isFieldHandleValid(handle))
+        return handle.dataSource->dataByColumnIndex(handle.column);
     return QVariant();
 }
 
+FieldHandle DataSourceManager::resolveField(const QString &fieldName)
+{
+    FieldHandle result;
+    QString datasourceName = extractDataSource(fieldName);
+    IDataSource* ds = dataSource(datasourceName);
+    if (ds){
+        int column = ds->columnIndexByName(extractFieldName(fieldName));
+        if (column != -1){
+            result.holder = m_datasources.value(datasourceName.toLower());
+            result.dataSource = ds;
+            result.column = column;
+            result.epoch = m_fieldHandlesEpoch;
+        }
+    }
+    return result;
+}
+
+void DataSourceManager::slotInvalidateFieldHandles()
+{
+    ++m_fieldHandlesEpoch;
+    m_fieldHandles.clear();
+}
+
 QVariant DataSourceManager::fieldDataByRowIndex(const QString &fieldName, int rowIndex)
 {
     if (containsField(fieldName)){
@@ -1756,6 +1839,7 @@ void DataSourceManager::reopenDatasource(const QString& datasourceName)
     if (qh){
         qh->invalidate(designTime()?IDataSource::DESIGN_MODE:IDataSource::RENDER_MODE);
         invalidateChildren(datasourceName);
+        slotInvalidateFieldHandles();
     }
 }
 
@@ -1835,7 +1919,14 @@ void DataSourceManager::setVariableDataType(const QString& name, VariableDataTyp
 
 void DataSourceManager::setAllDatasourcesToFirst()
 {
+    slotInvalidateFieldHandles();
     foreach(IDataSourceHolder* ds,m_datasources.values()) {
+        // the database can change between renders
+        SubQueryHolder* subQuery = dynamic_cast<SubQueryHolder*>(ds);
+        if (subQuery) subQuery->clearBatch();
+        // and so can the data of a callback datasource
+        CallbackDatasource* callback = dynamic_cast<CallbackDatasource*>(ds->dataSource());
+        if (callback) callback->invalidateKeyIndex();
         if (ds->dataSource()) ds->dataSource()->first();
     }
 }
@@ -44,6 +44,7 @@ namespace LimeReport{
 
 
 class DataSourceManager;
+class ScriptEngineManager;
 
 class DataNode {
 public:
@@ -92,6 +93,17 @@ private:
     DataNode* m_rootNode;
 };
 
+// "datasource.field" resolved to the datasource and the column it is read from,
+// valid while the manager's field handles epoch is the one it was resolved in
+struct FieldHandle{
+    FieldHandle(): holder(0), dataSource(0), column(-1), epoch(-1){}
+    bool isValid() const { return dataSource != 0 && column != -1; }
+    IDataSourceHolder* holder;
+    IDataSource* dataSource;
+    int column;
+    int epoch;
+};
+
 class DataSourceManager : public QObject, public ICollectionContainer, public IVariablesContainer, public IDataSourceManager
 {
     Q_OBJECT
@@ -113,6 +125,7 @@ public:
     bool checkConnectionDesc(ConnectionDesc *connection);
     void addQuery(const QString& name, const QString& sqlText, const QString& connectionName="");
     void addSubQuery(const QString& name, const QString& sqlText, const QString& connectionName, const QString& masterDatasource);
+    void setSubQueryBatchSize(const QString& name, int batchSize);
     void addProxy(const QString& name, const QString& master, const QString& detail, QList<FieldsCorrelation> fields);
     void addCSV(const QString& name, const QString& csvText, const QString& separator, bool firstRowIsHeader);
     bool addModel(const QString& name, QAbstractItemModel *model, bool owned);
@@ -166,12 +179,16 @@ public:
     bool dataSourceIsValid(const QString& name);
     IDataSource* dataSource(const QString& name);
     IDataSourceHolder* dataSourceHolder(const QString& name);
+    DataSourceStatistics dataSourceStatistics(const QString& name);
     QStringList dataSourceNames();
     QStringList dataSourceNames(const QString& connectionName);
     QStringList connectionNames();
     QStringList fieldNames(const QString& datasourceName);
     bool        containsField(const QString& fieldName);
     QVariant    fieldData(const QString& fieldName);
+    FieldHandle fieldHandle(const QString& fieldName);
+    bool        isFieldHandleValid(const FieldHandle& handle);
+    QVariant    fieldData(const FieldHandle& handle);
     QVariant    fieldDataByRowIndex(const QString& fieldName, int rowIndex);
     QVariant    fieldDataByRowIndex(const QString &fieldName, int rowIndex, int role);
     QVariant    fieldDataByRowIndex(const QString &fieldName, int rowIndex, const QString &roleName);
@@ -224,6 +241,8 @@ public:
 
     ReportSettings *reportSettings() const;
     void setReportSettings(ReportSettings *reportSettings);
+    ScriptEngineManager* scriptManager() const {return m_scriptManager;}
+    void setScriptManager(ScriptEngineManager* scriptManager){m_scriptManager = scriptManager;}
 
     bool hasChanges(){ return m_hasChanges; }
     void dropChanges(){ m_hasChanges = false; }
@@ -258,9 +277,11 @@ private slots:
     void slotVariableHasBeenAdded(const QString& variableName);
     void slotVariableHasBeenChanged(const QString& variableName);
     void slotCSVTextChanged(const QString& csvName, const QString& csvText);
+    void slotInvalidateFieldHandles();
 private:
     explicit DataSourceManager(QObject *parent = 0);
     bool initAndOpenDB(QSqlDatabase &db, ConnectionDesc &connectionDesc);
+    FieldHandle resolveField(const QString& fieldName);
     Q_DISABLE_COPY(DataSourceManager)
 private:
     QList<ConnectionDesc*> m_connections;
@@ -282,11 +303,14 @@ private:
     bool m_needUpdate;
     QString m_defaultDatabasePath;
     ReportSettings* m_reportSettings;
+    ScriptEngineManager* m_scriptManager;
     QHash<QString,int> m_groupFunctionsExpressionsMap;
     QVector<QString> m_groupFunctionsExpressions;
     IDbCredentialsProvider* m_dbCredentialsProvider;
 
     QMap< QString, QVector<QString> > m_varToDataSource;
+    QHash<QString, FieldHandle> m_fieldHandles;
+    int m_fieldHandlesEpoch;
 
     bool m_hasChanges;
 };
@@ -67,6 +67,11 @@ public:
     virtual bool variableIsSystem(const QString& name) = 0;
     virtual IDataSource* dataSource(const QString& name) = 0;
     virtual IDataSourceHolder* dataSourceHolder(const QString& name) = 0;
+    // not pure, so managers implemented outside the library keep compiling
+    virtual DataSourceStatistics dataSourceStatistics(const QString& name){
+        Q_UNUSED(name)
+        return DataSourceStatistics();
+    }
 };
 
 }
@@ -5,6 +5,7 @@
 #include <QSharedPointer>
 #include <QtPlugin>
 #include "lrpageitemdesignintf.h"
+#include "lrpagesinkintf.h"
 
 namespace LimeReport {
 
@@ -17,5 +18,10 @@ public:
     virtual QString hint() = 0;
 };
 
+class ReportExporterPageSinkInterface: public IPageSink {
+public:
+    virtual void setExportParams(const QString& fileName, const QMap<QString, QVariant>& params = QMap<QString, QVariant>()) = 0;
+};
+
 } // namespace LimeReport
 #endif // LREXPORTERINTF_H
@@ -90,11 +90,18 @@ namespace Const{
 
     const QString GROUP_FUNCTION_RX = "(%1\\s*"+GROUP_FUNCTION_PARAM_RX+")";
     const QString GROUP_FUNCTION_NAME_RX = "%1\\s*\\((.*[^\\)])\\)";
+    const QString UNBATCHABLE_SQL_RX = "\\b(?:limit|top|first|skip|offset|fetch|rownum|or|not|group|having|distinct|"
+                                       "union|intersect|except|minus|over|count|sum|avg|min|max)\\b";
     const int SCENE_MARGIN = 50;
     const QString FUNCTION_MANAGER_NAME = "LimeReport";
     const QString DATAFUNCTIONS_MANAGER_NAME = "DatasourceFunctions";
     const QString EOW("~!@#$%^&*()+{}|:\"<>?,/;'[]\\-=");
     const int DEFAULT_TAB_INDENTION = 4;
+    const int MAX_CONTENT_TEMPLATES = 4096;
+    const int MAX_REPORT_TEMPLATES = 64;
+    const int MAX_CALLBACK_KEY_INDEX_ROWS = 100000;
+    const int DEFAULT_TEXT_MEASURE_CACHE_SIZE = 10000;
+    const int DEFAULT_TEXT_DOCUMENT_CACHE_SIZE = 500;
     const int DOCKWIDGET_MARGINS = 4;
 
     const char SCRIPT_SIGN = 'S';
@@ -112,9 +119,11 @@ namespace Const{
     bool isColorDark(QColor color);
 
     enum ExpandType {EscapeSymbols, NoEscapeSymbols, ReplaceHTMLSymbols};
+    enum ExpandPart {ExpandVariables = 1, ExpandScripts = 2, ExpandDataFields = 4};
     enum RenderPass {FirstPass = 1, SecondPass = 2};
     enum ArrangeType {AsNeeded, Force};
     enum ScaleType {FitWidth, FitPage, OneToOne, Percents};
+    enum RenderMode {InteractiveRenderMode, HeadlessRenderMode};
     enum PreviewHint{ShowAllPreviewBars = 0,
                      HidePreviewToolBar = 1,
                      HidePreviewMenuBar = 2,
@@ -140,6 +149,22 @@ namespace Const{
         bool m_suppressAbsentFieldsAndVarsWarnings;
     };
 
+    struct TextMeasureCacheStatistics{
+        int capacity;
+        int size;
+        qint64 hits;
+        qint64 misses;
+        // lookups of the font size fitted by adaptFontToSize
+        qint64 fittedFontSizeHits;
+        qint64 fittedFontSizeMisses;
+    };
+
+    struct DataSourceStatistics{
+        int keyIndexes;
+        int keyIndexEntries;
+        qint64 keyIndexMemory;
+    };
+
     class LIMEREPORT_EXPORT IExternalPainter{
     public:
         virtual void paintByExternalPainter(const QString& objectName, QPainter* painter, const QStyleOptionGraphicsItem* options) = 0;
@@ -42,7 +42,7 @@ namespace LimeReport {
 
 void GroupFunction::slotBandRendered(BandDesignIntf *band)
 {
-    ScriptEngineManager& sm = ScriptEngineManager::instance();
+    ScriptEngineManager& sm = ScriptEngineManager::forDataManager(m_dataManager);
 
 #if (QT_VERSION < QT_VERSION_CHECK(5, 15, 1))
     QRegExp rxField(Const::FIELD_RX);
@@ -62,9 +62,9 @@ void GroupFunction::slotBandRendered(BandDesignIntf *band)
         if(matchField.hasMatch()){
             QString field = matchField.captured(1);
 #endif
-            if (m_dataManager->containsField(field)){
-                m_values.push_back(m_dataManager->fieldData(field));
-                m_valuesByBand.insert(band, m_dataManager->fieldData(field));
+            FieldHandle handle = m_dataManager->fieldHandle(field);
+            if (handle.isValid()){
+                addBandValue(band, m_dataManager->fieldData(handle));
             } else {
                 setInvalid(tr("Field \"%1\" not found").arg(m_data));
             }
@@ -81,8 +81,7 @@ void GroupFunction::slotBandRendered(BandDesignIntf *band)
             QString var = matchVar.captured(1);
 #endif
             if (m_dataManager->containsVariable(var)){
-                m_values.push_back(m_dataManager->variable(var));
-                m_valuesByBand.insert(band, m_dataManager->variable(var));
+                addBandValue(band, m_dataManager->variable(var));
             } else {
                 setInvalid(tr("Variable \"%1\" not found").arg(m_data));
             }
@@ -93,8 +92,7 @@ void GroupFunction::slotBandRendered(BandDesignIntf *band)
     {
         QVariant value = sm.evaluateScript(m_data);
         if (value.isValid()){
-            m_values.push_back(value);
-            m_valuesByBand.insert(band, value);
+            addBandValue(band, value);
         } else {
             setInvalid(tr("Wrong script syntax \"%1\" ").arg(m_data));
         }
@@ -104,11 +102,9 @@ void GroupFunction::slotBandRendered(BandDesignIntf *band)
         QString itemName = m_data;
         ContentItemDesignIntf* item = dynamic_cast<ContentItemDesignIntf*>(band->childByName(itemName.remove('"')));
         if (item){
-            m_values.push_back(item->content());
-            m_valuesByBand.insert(band, item->content());
+            addBandValue(band, item->content());
         } else if (m_name.compare("COUNT",Qt::CaseInsensitive) == 0) {
-            m_values.push_back(1);
-            m_valuesByBand.insert(band, 1);
+            addBandValue(band, 1);
         } else setInvalid(tr("Item \"%1\" not found").arg(m_data));
 
         break;
@@ -120,12 +116,83 @@ void GroupFunction::slotBandRendered(BandDesignIntf *band)
 
 void GroupFunction::slotBandReRendered(BandDesignIntf *oldBand, BandDesignIntf *newBand)
 {
-    if (m_valuesByBand.contains(oldBand)){
-        m_valuesByBand.insert(newBand, m_valuesByBand.value(oldBand));
-        m_valuesByBand.remove(oldBand);
+    if (oldBand->groupFunctionValues().contains(this)){
+        newBand->setGroupFunctionValue(this, oldBand->groupFunctionValues().value(this));
+        oldBand->removeGroupFunctionValue(this);
     }
 }
 
+void GroupFunction::addBandValue(BandDesignIntf *band, const QVariant &value)
+{
+    // the band keeps its value, so the page it is placed on can sum it up
+    pushValue(value);
+    band->setGroupFunctionValue(this, value);
+}
+
+void GroupFunction::pushValue(const QVariant &value)
+{
+    m_accumulator.addValue(value);
+    m_values.push_back(value);
+}
+
+void GroupFunction::popValue()
+{
+    // min and max can't be taken back, so the totals are collected again
+    if (!m_values.isEmpty()){
+        m_values.pop_back();
+        m_accumulator.clear();
+        foreach(QVariant value, m_values){
+            m_accumulator.addValue(value);
+        }
+    }
+}
+
+QVariant GroupFunction::lastValue() const
+{
+    return m_values.isEmpty() ? QVariant() : m_values.last();
+}
+
+void GroupFunction::clearValues()
+{
+    m_values.clear();
+    m_accumulator.clear();
+}
+
+const GroupFunctionAccumulator &GroupFunction::pageAccumulator(PageItemDesignIntf *page)
+{
+    return page->groupFunctionTotals(this);
+}
+
+void GroupFunctionAccumulator::addValue(const QVariant &value)
+{
+    double x = value.toDouble();
+    double t = m_sum + x;
+    // Neumaier variant of Kahan summation
+    if (qAbs(m_sum) >= qAbs(x))
+        m_compensation += (m_sum - t) + x;
+    else
+        m_compensation += (x - t) + m_sum;
+    m_sum = t;
+    if (m_count == 0 || m_min.toDouble() > x) m_min = value;
+    if (m_count == 0 || m_max.toDouble() < x) m_max = value;
+    ++m_count;
+}
+
+void GroupFunctionAccumulator::clear()
+{
+    m_count = 0;
+    m_sum = 0;
+    m_compensation = 0;
+    m_min = QVariant();
+    m_max = QVariant();
+}
+
+QVariant GroupFunctionAccumulator::sum() const
+{
+    if (m_count == 0) return 0;
+    return m_sum + m_compensation;
+}
+
 QVariant GroupFunction::addition(QVariant value1, QVariant value2)
 {
     return value1.toDouble()+value2.toDouble();
@@ -209,88 +276,34 @@ GroupFunctionFactory::~GroupFunctionFactory()
 
 QVariant SumGroupFunction::calculate(PageItemDesignIntf *page)
 {
-    QVariant res = 0;
-    if (!page){
-        foreach(QVariant value,values()){
-            res = addition(res,value);
-        }
-    } else {
-        foreach (BandDesignIntf* band, page->bands()) {
-            res = addition(res, m_valuesByBand.value(band));
-        }
-    }
-    return res;
+    return page ? pageAccumulator(page).sum() : accumulator().sum();
 }
 
 QVariant AvgGroupFunction::calculate(PageItemDesignIntf *page)
 {
-    QVariant res = QVariant();
-    if (!page){
-        foreach(QVariant value,values()){
-            res=addition(res,value);
-        }
-    } else {
-        foreach (BandDesignIntf* band, page->bands()) {
-            res = addition(res, m_valuesByBand.value(band));
-        }
-    }
-    if (!res.isNull()&&(values().count()>0)){
-        res=division(res,values().count());
-    }
-    return res;
+    const GroupFunctionAccumulator& totals = page ? pageAccumulator(page) : accumulator();
+    if (totals.count() > 0)
+        return division(totals.sum(), totals.count());
+    // a page with bands but without values gives 0 as before
+    if (page && !page->childBands().isEmpty())
+        return 0.0;
+    return QVariant();
 }
 
 QVariant MinGroupFunction::calculate(PageItemDesignIntf *page)
 {
     //TODO: check variant type
-    QVariant res = QVariant();
-    if (!page){
-        if (!values().empty()) res = values().at(0);
-        foreach(QVariant value, values()){
-            if (res.toDouble() > value.toDouble()) res = value;
-        }
-    } else {
-        if (!page->bands().empty()) res = m_valuesByBand.value(page->bands().at(0));
-        foreach (BandDesignIntf* band, page->bands()) {
-            if (res.toDouble() > m_valuesByBand.value(band).toDouble()) res = m_valuesByBand.value(band);
-        }
-    }
-
-    return res;
+    return page ? pageAccumulator(page).min() : accumulator().min();
 }
 
 QVariant MaxGroupFunction::calculate(PageItemDesignIntf *page)
 {
     //TODO: check variant type
-    QVariant res = QVariant();
-
-    if (!page){
-        if (!values().empty()) res = values().at(0);
-        foreach(QVariant value, values()){
-            if (res.toDouble() < value.toDouble()) res = value;
-        }
-    } else {
-        if (!page->bands().empty()) res = m_valuesByBand.value(page->bands().at(0));
-        foreach (BandDesignIntf* band, page->bands()) {
-            if (res.toDouble() < m_valuesByBand.value(band).toDouble()) res = m_valuesByBand.value(band);
-        }
-    }
-
-    return res;
+    return page ? pageAccumulator(page).max() : accumulator().max();
 }
 
 QVariant CountGroupFunction::calculate(PageItemDesignIntf *page){
-    if (!page){
-        return values().count();
-    } else {
-        int res = 0;
-        foreach (BandDesignIntf* band, page->bands()) {
-            if (!m_valuesByBand.value(band).isNull()){
-                res++;
-            }
-        }
-        return res;
-    }
+    return page ? pageAccumulator(page).count() : accumulator().count();
 }
 
 } //namespace LimeReport
@@ -33,6 +33,7 @@
 #include <QString>
 #include <QVariant>
 #include <QVector>
+#include <QHash>
 
 namespace LimeReport{
 
@@ -40,6 +41,23 @@ class DataSourceManager;
 class BandDesignIntf;
 class PageItemDesignIntf;
 
+class GroupFunctionAccumulator{
+public:
+    GroupFunctionAccumulator(): m_count(0), m_sum(0), m_compensation(0){}
+    void addValue(const QVariant& value);
+    void clear();
+    int count() const {return m_count;}
+    QVariant sum() const;
+    QVariant min() const {return m_min;}
+    QVariant max() const {return m_max;}
+private:
+    int m_count;
+    double m_sum;
+    double m_compensation;
+    QVariant m_min;
+    QVariant m_max;
+};
+
 class GroupFunction : public QObject{
     Q_OBJECT
 public:
@@ -51,9 +69,15 @@ public:
     const QString& data(){return m_data;}
     const QString& error(){return m_errorMessage;}
     QVector<QVariant>& values(){return m_values;}
-    QHash<BandDesignIntf*, QVariant> m_valuesByBand;
     const QString& dataBandName(){return m_dataBandName;}
     virtual QVariant calculate(PageItemDesignIntf* page = 0)=0;
+    const GroupFunctionAccumulator& accumulator() const {return m_accumulator;}
+    const GroupFunctionAccumulator& pageAccumulator(PageItemDesignIntf* page);
+    bool hasValues() const {return m_accumulator.count() > 0;}
+    QVariant lastValue() const;
+    void pushValue(const QVariant& value);
+    void popValue();
+    void clearValues();
 public slots:
     void slotBandRendered(BandDesignIntf* band);
     void slotBandReRendered(BandDesignIntf* oldBand, BandDesignIntf* newBand);
@@ -63,12 +87,15 @@ protected:
     QVariant subtraction(QVariant value1, QVariant value2);
     QVariant division(QVariant value1, QVariant value2);
     QVariant multiplication(QVariant value1, QVariant value2);
+private:
+    void addBandValue(BandDesignIntf* band, const QVariant& value);
 private:
     QString m_data;
     QString m_name;
     DataType m_dataType;
     QString m_dataBandName;
     QVector<QVariant> m_values;
+    GroupFunctionAccumulator m_accumulator;
     DataSourceManager* m_dataManager;
     bool m_isValid;
     QString m_errorMessage;
@@ -138,4 +138,9 @@ void ContentItemDesignIntf::setContentBackedUp(bool contentBackedUp)
     m_contentBackedUp = contentBackedUp;
 }
 
+bool ContentItemDesignIntf::hasSecondPassContent() const
+{
+    return m_contentBackedUp || BaseDesignIntf::hasSecondPassContent();
+}
+
 }// namespace LimeReport
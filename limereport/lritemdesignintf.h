@@ -85,8 +85,11 @@ public:
     QMap<QString, QString> getStringForTranslation();
     void backupContent(){ m_contentBackUp = content(); m_contentBackedUp = true;}
     void restoreContent() {setContent(m_contentBackUp);}
+    QString contentBackUp() const {return m_contentBackUp;}
+    void setContentBackUp(const QString& value){ m_contentBackUp = value; m_contentBackedUp = true;}
     bool isContentBackedUp() const;
     void setContentBackedUp(bool contentBackedUp);
+    bool hasSecondPassContent() const;
 private:
     QString m_contentBackUp;
     bool m_contentBackedUp;
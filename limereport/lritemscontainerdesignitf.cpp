@@ -2,6 +2,8 @@
 #include "lritemdesignintf.h"
 #include "lrbanddesignintf.h"
 
+#include <limits>
+
 namespace LimeReport {
 
 bool Segment::intersect(Segment value)
@@ -49,6 +51,20 @@ void ItemsContainerDesignInft::snapshotItemsLayout(SnapshotType type)
     std::sort(m_containerItems.begin(),m_containerItems.end(),itemSortContainerLessThen);
 }
 
+// Area of the item shape in parent coordinates with a safety margin:
+// items whose areas don't intersect can't collide
+static QRectF collisionArea(BaseDesignIntf* item)
+{
+    return item->mapRectToParent(item->boundingRect()).adjusted(-1, -1, 1, 1);
+}
+
+typedef QPair<qreal, int> SweepEntry;
+
+static bool sweepEntryLessThen(const SweepEntry& e1, const SweepEntry& e2)
+{
+    return e1.first < e2.first;
+}
+
 void ItemsContainerDesignInft::arrangeSubItems(RenderPass pass, DataSourceManager *dataManager, ArrangeType type)
 {
     bool needArrage=(type==Force);
@@ -61,22 +77,62 @@ void ItemsContainerDesignInft::arrangeSubItems(RenderPass pass, DataSourceManage
     }
 
     if (needArrage){
+        // Only an item that has grown or moved since the snapshot can shift the items
+        // after it. Candidates for collision with such an item are found by a sweep over
+        // the left edges of the items: sizes don't change while arranging, so an item
+        // can't reach the current one if it starts more than the widest area to the left.
+        QVector<QRectF> areas(m_containerItems.count());
+        QVector<SweepEntry> sweep(m_containerItems.count());
+        qreal maxWidth = 0;
+        for (int i=0;i<m_containerItems.count();i++){
+            areas[i] = collisionArea(m_containerItems[i]->m_item);
+            maxWidth = qMax(maxWidth, areas[i].width());
+        }
+        bool sweepChanged = true;
+        QVector<int> candidates;
+
         for (int i=0;i<m_containerItems.count();i++){
-            for (int j=i;j<m_containerItems.count();j++){
-                if ((i!=j) && (m_containerItems[i]->m_item->collidesWithItem(m_containerItems[j]->m_item))){
-                    HSegment hS1(m_containerItems[j]->m_rect),hS2(m_containerItems[i]->m_rect);
-                    VSegment vS1(m_containerItems[j]->m_rect),vS2(m_containerItems[i]->m_rect);
-                    if (m_containerItems[i]->m_rect.bottom()<m_containerItems[i]->m_item->geometry().bottom()){
+            PItemSortContainer current = m_containerItems[i];
+            bool bottomChanged = current->m_rect.bottom()<current->m_item->geometry().bottom();
+            bool rightChanged = current->m_rect.right()<current->m_item->geometry().right();
+            if (!bottomChanged && !rightChanged) continue;
+
+            if (sweepChanged){
+                for (int k=0;k<m_containerItems.count();k++)
+                    sweep[k] = SweepEntry(areas[k].left(), k);
+                std::sort(sweep.begin(), sweep.end(), sweepEntryLessThen);
+                sweepChanged = false;
+            }
+
+            candidates.clear();
+            QVector<SweepEntry>::const_iterator it = std::lower_bound(
+                sweep.constBegin(), sweep.constEnd(), SweepEntry(areas[i].left()-maxWidth, 0), sweepEntryLessThen
+            );
+            for (; it != sweep.constEnd() && it->first <= areas[i].right(); ++it){
+                if (it->second > i && areas[it->second].intersects(areas[i]))
+                    candidates.append(it->second);
+            }
+            std::sort(candidates.begin(), candidates.end());
+
+            foreach (int j, candidates) {
+                if (current->m_item->collidesWithItem(m_containerItems[j]->m_item)){
+                    HSegment hS1(m_containerItems[j]->m_rect),hS2(current->m_rect);
+                    VSegment vS1(m_containerItems[j]->m_rect),vS2(current->m_rect);
+                    if (bottomChanged){
                        if (hS1.intersectValue(hS2)>vS1.intersectValue(vS2))
-                           m_containerItems[j]->m_item->setY(m_containerItems[i]->m_item->y()+m_containerItems[i]->m_item->height()
-                                                      +m_containerItems[j]->m_rect.top()-m_containerItems[i]->m_rect.bottom());
+                           m_containerItems[j]->m_item->setY(current->m_item->y()+current->m_item->height()
+                                                      +m_containerItems[j]->m_rect.top()-current->m_rect.bottom());
 
                     }
-                    if (m_containerItems[i]->m_rect.right()<m_containerItems[i]->m_item->geometry().right()){
+                    if (rightChanged){
                        if (vS1.intersectValue(vS2)>hS1.intersectValue(hS2))
-                       m_containerItems[j]->m_item->setX(m_containerItems[i]->m_item->geometry().right()+
-                                                  (m_containerItems[j]->m_rect.x()-m_containerItems[i]->m_rect.right()));
+                       m_containerItems[j]->m_item->setX(current->m_item->geometry().right()+
+                                                  (m_containerItems[j]->m_rect.x()-current->m_rect.right()));
                     }
+                    m_extentsValid = false;
+                    QRectF area = collisionArea(m_containerItems[j]->m_item);
+                    if (area.left() != areas[j].left()) sweepChanged = true;
+                    areas[j] = area;
                 }
             }
         }
@@ -96,36 +152,39 @@ void ItemsContainerDesignInft::arrangeSubItems(RenderPass pass, DataSourceManage
 
 qreal ItemsContainerDesignInft::findMaxBottom() const
 {
-    qreal maxBottom = 0;
-    foreach(QGraphicsItem* item,childItems()){
-        BaseDesignIntf* subItem = dynamic_cast<BaseDesignIntf *>(item);
-        if(subItem)
-           if ( subItem->isVisible() && (subItem->geometry().bottom()>maxBottom) )
-               maxBottom = subItem->geometry().bottom();
-    }
-    return maxBottom;
+    if (!m_extentsValid) updateExtents();
+    return m_maxBottom;
 }
 
 qreal ItemsContainerDesignInft::findMinTop() const{
-    qreal minTop = height();
-    foreach(QGraphicsItem* item,childItems()){
-        BaseDesignIntf* subItem = dynamic_cast<BaseDesignIntf *>(item);
-        if(subItem)
-           if ( subItem->isVisible() && (subItem->geometry().top()<minTop) )
-               minTop = subItem->geometry().top();
-    }
+    if (!m_extentsValid) updateExtents();
+    qreal minTop = qMin(height(), m_minTop);
     return minTop > 0 ? minTop : 0;
 }
 
 qreal ItemsContainerDesignInft::findMaxHeight() const
 {
-    qreal maxHeight=0;
+    if (!m_extentsValid) updateExtents();
+    return m_maxHeight;
+}
+
+void ItemsContainerDesignInft::updateExtents() const
+{
+    m_maxBottom = 0;
+    m_minTop = std::numeric_limits<qreal>::max();
+    m_maxHeight = 0;
     foreach(QGraphicsItem* item,childItems()){
         BaseDesignIntf* subItem = dynamic_cast<BaseDesignIntf *>(item);
-        if(subItem)
-           if (subItem->geometry().height()>maxHeight) maxHeight=subItem->geometry().height();
+        if(subItem){
+            QRect geometry = subItem->geometry();
+            if (subItem->isVisible()){
+                if (geometry.bottom()>m_maxBottom) m_maxBottom = geometry.bottom();
+                if (geometry.top()<m_minTop) m_minTop = geometry.top();
+            }
+            if (geometry.height()>m_maxHeight) m_maxHeight = geometry.height();
+        }
     }
-    return maxHeight;
+    m_extentsValid = true;
 }
 
 } // namespace LimeReport
@@ -41,7 +41,8 @@ class LIMEREPORT_EXPORT ItemsContainerDesignInft : public BookmarkContainerDesig
     Q_OBJECT
 public:
   ItemsContainerDesignInft(const QString& xmlTypeName, QObject* owner = 0, QGraphicsItem* parent=0):
-      BookmarkContainerDesignIntf(xmlTypeName, owner, parent){}
+      BookmarkContainerDesignIntf(xmlTypeName, owner, parent), m_extentsValid(false),
+      m_maxBottom(0), m_minTop(0), m_maxHeight(0){}
   enum SnapshotType{Full, IgnoreBands};
 protected:
   void  snapshotItemsLayout(SnapshotType type = Full);
@@ -49,8 +50,17 @@ protected:
   qreal findMaxBottom() const;
   qreal findMaxHeight() const;
   qreal findMinTop() const;
+  void  childGeometryChangedEvent(){ m_extentsValid = false; }
+private:
+  void  updateExtents() const;
 private:
   QVector<PItemSortContainer> m_containerItems;
+  // extents of the children, recalculated after a child has been moved, resized,
+  // shown, hidden, added or removed
+  mutable bool  m_extentsValid;
+  mutable qreal m_maxBottom;
+  mutable qreal m_minTop;
+  mutable qreal m_maxHeight;
 
 };
 
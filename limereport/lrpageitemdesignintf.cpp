@@ -210,12 +210,27 @@ BandDesignIntf* PageItemDesignIntf::bandByIndex(int index)
 
 BandDesignIntf *PageItemDesignIntf::bandByName(QString bandObjectName)
 {
-    foreach(BandDesignIntf* band, childBands()){
-        if (band->objectName().compare(bandObjectName,Qt::CaseInsensitive)==0){
-            return band;
-        }
+    // m_indexedBands shares data with m_bands until the band list is changed,
+    // so the comparison is cheap while the index is up to date
+    if (m_indexedBands != m_bands) updateBandsIndex();
+    QString key = bandObjectName.toCaseFolded();
+    BandDesignIntf* band = m_bandsByName.value(key);
+    if (band && band->objectName().compare(bandObjectName,Qt::CaseInsensitive)==0)
+        return band;
+    // a band could have been renamed
+    updateBandsIndex();
+    return m_bandsByName.value(key);
+}
+
+void PageItemDesignIntf::updateBandsIndex()
+{
+    m_indexedBands = m_bands;
+    m_bandsByName.clear();
+    foreach(BandDesignIntf* band, m_indexedBands){
+        QString key = band->objectName().toCaseFolded();
+        if (!m_bandsByName.contains(key))
+            m_bandsByName.insert(key, band);
     }
-    return 0;
 }
 
 int PageItemDesignIntf::calcBandIndex(BandDesignIntf::BandsType bandType, BandDesignIntf *parentBand, bool& increaseBandIndex)
@@ -320,10 +335,15 @@ bool PageItemDesignIntf::isBandRegistred(BandDesignIntf *band)
 void PageItemDesignIntf::registerBand(BandDesignIntf *band)
 {
     if (!isBandRegistred(band)){
+        bool totalsValid = m_groupFunctionBands == m_bands;
         if (band->bandIndex() > childBands().count() - 1)
             m_bands.append(band);
         else
             m_bands.insert(band->bandIndex(), band);
+        if (totalsValid){
+            addGroupFunctionValues(band);
+            m_groupFunctionBands = m_bands;
+        }
         band->setParent(this);
         band->setParentItem(this);
         band->setWidth(pageRect().width() / band->columnsCount());
@@ -336,6 +356,34 @@ void PageItemDesignIntf::registerBand(BandDesignIntf *band)
     }
 }
 
+void PageItemDesignIntf::addSecondPassItem(BaseDesignIntf *item)
+{
+    foreach(const QPointer<BaseDesignIntf>& secondPassItem, m_secondPassItems){
+        if (secondPassItem.data() == item) return;
+    }
+    m_secondPassItems.append(item);
+}
+
+QList<BaseDesignIntf*> PageItemDesignIntf::secondPassItems() const
+{
+    // items can be deleted or moved to another page after they have been added
+    QList<BaseDesignIntf*> result;
+    foreach(const QPointer<BaseDesignIntf>& item, m_secondPassItems){
+        if (item && item->parentItem() == this)
+            result.append(item.data());
+    }
+    return result;
+}
+
+void PageItemDesignIntf::collectSecondPassItems()
+{
+    m_secondPassItems.clear();
+    foreach(BaseDesignIntf* item, childBaseItems()){
+        if (item->hasSecondPassContent())
+            m_secondPassItems.append(item);
+    }
+}
+
 void PageItemDesignIntf::initColumnsPos(QVector<qreal> &posByColumns, qreal pos, int columnCount){
     posByColumns.clear();
     for(int i=0;i<columnCount;++i){
@@ -605,6 +653,33 @@ void PageItemDesignIntf::removeBand(BandDesignIntf *band)
     }
 }
 
+const GroupFunctionAccumulator &PageItemDesignIntf::groupFunctionTotals(GroupFunction *groupFunction)
+{
+    // the totals are collected again only after bands were taken off the page
+    if (m_groupFunctionBands != m_bands){
+        m_groupFunctionTotals.clear();
+        foreach(BandDesignIntf* band, m_bands)
+            addGroupFunctionValues(band);
+        m_groupFunctionBands = m_bands;
+    }
+    return m_groupFunctionTotals[groupFunction];
+}
+
+void PageItemDesignIntf::invalidateGroupFunctionTotals()
+{
+    m_groupFunctionBands.clear();
+    m_groupFunctionTotals.clear();
+}
+
+void PageItemDesignIntf::addGroupFunctionValues(BandDesignIntf *band)
+{
+    QHash<GroupFunction*, QVariant>::const_iterator it = band->groupFunctionValues().constBegin();
+    for (; it != band->groupFunctionValues().constEnd(); ++it){
+        if (!it.value().isNull())
+            m_groupFunctionTotals[it.key()].addValue(it.value());
+    }
+}
+
 int PageItemDesignIntf::dataBandCount()
 {
     int count=0;
@@ -32,6 +32,7 @@
 #include "lrbasedesignintf.h"
 #include "lrbanddesignintf.h"
 #include "lritemscontainerdesignitf.h"
+#include "lrgroupfunctions.h"
 #include <QList>
 #include <QColor>
 #include <QPrinter>
@@ -138,7 +139,13 @@ public:
     bool isBandRegistred(BandDesignIntf* band);
     void registerBand(BandDesignIntf* band);
     void relocateBands();
+    void addSecondPassItem(BaseDesignIntf* item);
+    QList<BaseDesignIntf*> secondPassItems() const;
+    void collectSecondPassItems();
     void removeBand(BandDesignIntf* band);
+    // totals of the values the group function took from the bands on this page
+    const GroupFunctionAccumulator& groupFunctionTotals(GroupFunction* groupFunction);
+    void invalidateGroupFunctionTotals();
 
     int dataBandCount();
     BandDesignIntf* dataBandAt(int index);
@@ -233,6 +240,8 @@ protected:
 private:
     void paintGrid(QPainter *ppainter, QRectF rect);
     void initColumnsPos(QVector<qreal>&posByColumns, qreal pos, int columnCount);
+    void updateBandsIndex();
+    void addGroupFunctionValues(BandDesignIntf* band);
 private:
     int m_topMargin;
     int m_bottomMargin;
@@ -243,6 +252,12 @@ private:
     QRectF m_pageRect;
     bool m_sizeChainging;
     QList<BandDesignIntf*> m_bands;
+    BandsList m_indexedBands;
+    QHash<QString, BandDesignIntf*> m_bandsByName;
+    // the totals are valid as long as this list equals m_bands
+    BandsList m_groupFunctionBands;
+    QHash<GroupFunction*, GroupFunctionAccumulator> m_groupFunctionTotals;
+    QList< QPointer<BaseDesignIntf> > m_secondPassItems;
     bool m_fullPage;
     bool m_oldPrintMode;
     bool m_resetPageNumber;
@@ -0,0 +1,15 @@
+#ifndef LRPAGESINKINTF_H
+#define LRPAGESINKINTF_H
+#include <QSharedPointer>
+#include "lrglobal.h"
+namespace LimeReport {
+class PageItemDesignIntf;
+class LIMEREPORT_EXPORT IPageSink{
+public:
+    virtual ~IPageSink(){};
+    virtual bool startPages() = 0;
+    virtual bool putPage(QSharedPointer<PageItemDesignIntf> page) = 0;
+    virtual bool finishPages() = 0;
+};
+} //namespace LimeReport
+#endif // LRPAGESINKINTF_H
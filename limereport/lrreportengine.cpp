@@ -57,6 +57,7 @@
 
 #include "serializators/lrxmlwriter.h"
 #include "serializators/lrxmlreader.h"
+#include "items/lrtextmeasurecache.h"
 #include "lrreportrender.h"
 #include "lrpreviewreportwindow.h"
 #include "lrpreviewreportwidget.h"
@@ -78,6 +79,18 @@
 
 namespace LimeReport{
 
+#ifdef HAVE_STATIC_BUILD
+static bool initFactories(){
+    initResources();
+    initReportItems();
+#ifdef HAVE_REPORT_DESIGNER
+    initObjectInspectorProperties();
+#endif
+    initSerializators();
+    return true;
+}
+#endif
+
 QSettings* ReportEngine::m_settings = 0;
 
 ReportEnginePrivate::ReportEnginePrivate(QObject *parent) :
@@ -91,20 +104,20 @@ ReportEnginePrivate::ReportEnginePrivate(QObject *parent) :
     m_previewScaleType(FitWidth), m_previewScalePercent(0), m_startTOCPage(0),
     m_previewPageBackgroundColor(Qt::gray),
     m_saveToFileVisible(true), m_printToPdfVisible(true),
-    m_printVisible(true)
+    m_printVisible(true), m_pageStreaming(false),
+    m_renderMode(InteractiveRenderMode), m_eventsProcessingInterval(0),
+    m_templateCacheEnabled(false), m_scriptManager(new ScriptEngineManager())
 {
 #ifdef HAVE_STATIC_BUILD
-    initResources();
-    initReportItems();
-#ifdef HAVE_REPORT_DESIGNER
-    initObjectInspectorProperties();
-#endif
-    initSerializators();
+    static bool factoriesInitialized = initFactories();
+    Q_UNUSED(factoriesInitialized);
 #endif
     m_datasources = new DataSourceManager(this);
     m_datasources->setReportSettings(&m_reportSettings);
-    scriptManager()->setDataManager(m_datasources);
+    m_datasources->setScriptManager(m_scriptManager);
     m_scriptEngineContext = new ScriptEngineContext(this);
+    m_scriptEngineContext->setScriptManager(m_scriptManager);
+    scriptManager()->setDataManager(m_datasources);
 
     ICallbackDatasource* tableOfContents = m_datasources->createCallbackDatasource("tableofcontents");
     connect(tableOfContents, SIGNAL(getCallbackData(LimeReport::CallbackInfo,QVariant&)),
@@ -155,6 +168,9 @@ ReportEnginePrivate::~ReportEnginePrivate()
 
     if (m_ownedSettings&&m_settings) delete m_settings;
     delete m_preparedPagesManager;
+    // dialogs are owned by the script context, release them before the script engine
+    m_scriptEngineContext->clear();
+    delete m_scriptManager;
 }
 
 QObject* ReportEnginePrivate::createElement(const QString &, const QString &)
@@ -305,7 +321,11 @@ bool ReportEnginePrivate::printPages(ReportPages pages, QPrinter *printer)
 void ReportEnginePrivate::internalPrintPages(ReportPages pages, QPrinter &printer)
 {
     int currenPage = 1;
-    m_cancelPrinting = false;
+    m_cancelPrinting.storeRelease(0);
+    EventsProcessor eventsProcessor;
+    eventsProcessor.setRenderMode(m_renderMode);
+    eventsProcessor.setInterval(m_eventsProcessingInterval);
+    eventsProcessor.start();
     QMap<QString, QSharedPointer<PrintProcessor> > printProcessors;
     printProcessors.insert("default",QSharedPointer<PrintProcessor>(new PrintProcessor(&printer)));
 
@@ -315,7 +335,7 @@ void ReportEnginePrivate::internalPrintPages(ReportPages pages, QPrinter &printe
 
     emit printingStarted(pageCount);
     foreach(PageItemDesignIntf::Ptr page, pages){
-        if (    !m_cancelPrinting &&
+        if (    !m_cancelPrinting.loadAcquire() &&
                 ((printer.printRange() == QPrinter::AllPages) ||
                 (   (printer.printRange()==QPrinter::PageRange) &&
                     (currenPage >= printer.fromPage()) &&
@@ -325,7 +345,7 @@ void ReportEnginePrivate::internalPrintPages(ReportPages pages, QPrinter &printe
         {
               printProcessors["default"]->printPage(page);
               emit pagePrintingFinished(currenPage);
-              QApplication::processEvents();
+              eventsProcessor.processEvents();
         }
 
         currenPage++;
@@ -336,7 +356,11 @@ void ReportEnginePrivate::internalPrintPages(ReportPages pages, QPrinter &printe
 void ReportEnginePrivate::printPages(ReportPages pages, QMap<QString, QPrinter*> printers, bool printToAllPrinters)
 {
     if (printers.values().isEmpty()) return;
-    m_cancelPrinting = false;
+    m_cancelPrinting.storeRelease(0);
+    EventsProcessor eventsProcessor;
+    eventsProcessor.setRenderMode(m_renderMode);
+    eventsProcessor.setInterval(m_eventsProcessingInterval);
+    eventsProcessor.start();
 
     QMap<QString, QSharedPointer<PrintProcessor> > printProcessors;
     for (int i = 0; i < printers.keys().count(); ++i) {
@@ -351,7 +375,7 @@ void ReportEnginePrivate::printPages(ReportPages pages, QMap<QString, QPrinter*>
     emit printingStarted(pages.size());
 
     for(int i = 0; i < pages.size(); ++i){
-        if (m_cancelPrinting) break;
+        if (m_cancelPrinting.loadAcquire()) break;
         PageItemDesignIntf::Ptr page = pages.at(i);
         if (!printToAllPrinters){
             if (printProcessors.contains(page->printerName()))
@@ -364,7 +388,7 @@ void ReportEnginePrivate::printPages(ReportPages pages, QMap<QString, QPrinter*>
             else currentPrinter = 0;
         }
         emit pagePrintingFinished(i+1);
-        QApplication::processEvents();
+        eventsProcessor.processEvents();
     }
 
     emit printingFinished();
@@ -475,11 +499,18 @@ bool ReportEnginePrivate::exportReport(QString exporterName, const QString &file
             if (fi.suffix().isEmpty())
                 fn += QString(".%1").arg(e->exporterFileExt());
 
-            bool designTime = dataManager()->designTime();
-            dataManager()->setDesignTime(false);
-            ReportPages pages = renderToPages();
-            dataManager()->setDesignTime(designTime);
-            bool result = e->exportPages(pages, fn, params);
+            bool result = false;
+            ReportExporterPageSinkInterface* pageSink = dynamic_cast<ReportExporterPageSinkInterface*>(e);
+            if (m_pageStreaming && pageSink){
+                pageSink->setExportParams(fn, params);
+                result = renderToPageSink(pageSink);
+            } else {
+                bool designTime = dataManager()->designTime();
+                dataManager()->setDesignTime(false);
+                ReportPages pages = renderToPages();
+                dataManager()->setDesignTime(designTime);
+                result = e->exportPages(pages, fn, params);
+            }
             delete e;
             return result;
         }
@@ -487,6 +518,41 @@ bool ReportEnginePrivate::exportReport(QString exporterName, const QString &file
     return false;
 }
 
+bool ReportEnginePrivate::canStreamPages()
+{
+    foreach(PageDesignIntf* page, m_pages){
+        if (page->pageItem()->isTOC() || page->pageItem()->mixWithPriorPage())
+            return false;
+    }
+    return true;
+}
+
+bool ReportEnginePrivate::renderToPageSink(IPageSink *pageSink)
+{
+    if (!pageSink || m_reportRendering) return false;
+    if (!pageSink->startPages()) return false;
+    bool designTime = dataManager()->designTime();
+    try{
+        dataManager()->setDesignTime(false);
+        if (canStreamPages()){
+            renderToPages(pageSink);
+        } else {
+            // TOC and mixed pages need the whole page list, so the pages are
+            // rendered as usual and handed to the sink afterwards.
+            foreach(PageItemDesignIntf::Ptr page, renderToPages()){
+                if (!pageSink->putPage(page)) break;
+            }
+        }
+        dataManager()->setDesignTime(designTime);
+    } catch(ReportError &exception){
+        dataManager()->setDesignTime(designTime);
+        saveError(exception.what());
+        pageSink->finishPages();
+        return false;
+    }
+    return pageSink->finishPages();
+}
+
 bool ReportEnginePrivate::showPreviewWindow(ReportPages pages, PreviewHints hints, QPrinter* printer)
 {
     Q_UNUSED(printer)
@@ -681,7 +747,9 @@ bool ReportEnginePrivate::slotLoadFromFile(const QString &fileName)
 
     clearReport();
 
-    ItemsReaderIntf::Ptr reader = FileXMLReader::create(fileName);
+    ItemsReaderIntf::Ptr reader = m_templateCacheEnabled ?
+                ReportTemplateCache::instance().fileReader(fileName, m_passPhrase) :
+                FileXMLReader::create(fileName);
     reader->setPassPhrase(m_passPhrase);
     if (reader->first()){
         if (reader->readItem(this)){
@@ -721,14 +789,13 @@ bool ReportEnginePrivate::slotLoadFromFile(const QString &fileName)
 
 void ReportEnginePrivate::cancelRender()
 {
-    if (m_reportRender)
-        m_reportRender->cancelRender();
-    m_reportRendering = false;
+    // can be called from another thread, the render polls the flag
+    m_cancelRender.storeRelease(1);
 }
 
 void ReportEnginePrivate::cancelPrinting()
 {
-    m_cancelPrinting = true;
+    m_cancelPrinting.storeRelease(1);
 }
 
 QGraphicsScene* ReportEngine::createPreviewScene(QObject* parent){
@@ -800,7 +867,9 @@ bool ReportEnginePrivate::loadFromFile(const QString &fileName, bool autoLoadPre
 bool ReportEnginePrivate::loadFromByteArray(QByteArray* data, const QString &name){
     clearReport();
 
-    ItemsReaderIntf::Ptr reader = ByteArrayXMLReader::create(data);
+    ItemsReaderIntf::Ptr reader = m_templateCacheEnabled ?
+                ReportTemplateCache::instance().byteArrayReader(data, m_passPhrase) :
+                ByteArrayXMLReader::create(data);
     reader->setPassPhrase(m_passPhrase);
     if (reader->first()){
         if (reader->readItem(this)){
@@ -817,7 +886,9 @@ bool ReportEnginePrivate::loadFromString(const QString &report, const QString &n
 {
     clearReport();
 
-    ItemsReaderIntf::Ptr reader = StringXMLreader::create(report);
+    ItemsReaderIntf::Ptr reader = m_templateCacheEnabled ?
+                ReportTemplateCache::instance().stringReader(report, m_passPhrase) :
+                StringXMLreader::create(report);
     reader->setPassPhrase(m_passPhrase);
     if (reader->first()){
         if (reader->readItem(this)){
@@ -1259,14 +1330,16 @@ void ReportEnginePrivate::clearRenderingPages(){
     m_renderingPages.clear();
 }
 
-ReportPages ReportEnginePrivate::renderToPages()
+ReportPages ReportEnginePrivate::renderToPages(IPageSink* pageSink)
 {
     int startTOCPage = -1;
     int pageAfterTOCIndex = -1;
 
     if (m_reportRendering) return ReportPages();
+    m_cancelRender.storeRelease(0);
     initReport();
     m_reportRender = ReportRender::Ptr(new ReportRender);
+    m_reportRender->setRenderCanceledFlag(&m_cancelRender);
     updateTranslations();
     connect(m_reportRender.data(),SIGNAL(pageRendered(int)),
             this, SIGNAL(renderPageFinished(int)));
@@ -1280,6 +1353,9 @@ ReportPages ReportEnginePrivate::renderToPages()
         m_reportRendering = true;
         m_reportRender->setDatasources(dataManager());
         m_reportRender->setScriptContext(scriptContext());
+        m_reportRender->setPageSink(pageSink);
+        m_reportRender->setRenderMode(m_renderMode);
+        m_reportRender->setEventsProcessingInterval(m_eventsProcessingInterval);
         clearRenderingPages();
         foreach (PageDesignIntf* page, m_pages) {
 
@@ -1302,7 +1378,7 @@ ReportPages ReportEnginePrivate::renderToPages()
 
         scriptContext()->qobjectToScript("engine",this);
 #ifdef USE_QTSCRIPTENGINE
-    ScriptEngineManager::instance().scriptEngine()->pushContext();
+    m_scriptManager->scriptEngine()->pushContext();
 #endif
         if (m_scriptEngineContext->runInitScript()){
 
@@ -1358,7 +1434,10 @@ ReportPages ReportEnginePrivate::renderToPages()
                 }
             }
 
-            m_reportRender->secondRenderPass(result);
+            if (pageSink)
+                m_reportRender->finishPageStream();
+            else
+                m_reportRender->secondRenderPass(result);
 
             emit renderFinished();
             m_reportRender.clear();
@@ -1367,7 +1446,7 @@ ReportPages ReportEnginePrivate::renderToPages()
         m_reportRendering = false;
 
 #ifdef USE_QTSCRIPTENGINE
-    ScriptEngineManager::instance().scriptEngine()->popContext();
+    m_scriptManager->scriptEngine()->popContext();
 #endif
         return result;
     } else {
@@ -1473,6 +1552,80 @@ bool ReportEngine::exportReport(QString exporterName, const QString &fileName, c
     return d->exportReport(exporterName, fileName, params);
 }
 
+bool ReportEngine::renderToPageSink(IPageSink *pageSink)
+{
+    Q_D(ReportEngine);
+    return d->renderToPageSink(pageSink);
+}
+
+void ReportEngine::setPageStreaming(bool value)
+{
+    Q_D(ReportEngine);
+    d->setPageStreaming(value);
+}
+
+bool ReportEngine::pageStreaming()
+{
+    Q_D(ReportEngine);
+    return d->pageStreaming();
+}
+
+void ReportEngine::setRenderMode(RenderMode value)
+{
+    Q_D(ReportEngine);
+    d->setRenderMode(value);
+}
+
+RenderMode ReportEngine::renderMode()
+{
+    Q_D(ReportEngine);
+    return d->renderMode();
+}
+
+void ReportEngine::setEventsProcessingInterval(int msec)
+{
+    Q_D(ReportEngine);
+    d->setEventsProcessingInterval(msec);
+}
+
+int ReportEngine::eventsProcessingInterval()
+{
+    Q_D(ReportEngine);
+    return d->eventsProcessingInterval();
+}
+
+void ReportEngine::setTemplateCacheEnabled(bool value)
+{
+    Q_D(ReportEngine);
+    d->setTemplateCacheEnabled(value);
+}
+
+bool ReportEngine::templateCacheEnabled()
+{
+    Q_D(ReportEngine);
+    return d->templateCacheEnabled();
+}
+
+void ReportEngine::clearTemplateCache()
+{
+    ReportTemplateCache::instance().clear();
+}
+
+void ReportEngine::setTextMeasureCacheSize(int value)
+{
+    TextMeasureCache::instance().setCapacity(value);
+}
+
+TextMeasureCacheStatistics ReportEngine::textMeasureCacheStatistics()
+{
+    return TextMeasureCache::instance().statistics();
+}
+
+void ReportEngine::clearTextMeasureCache()
+{
+    TextMeasureCache::instance().clear();
+}
+
 void ReportEngine::previewReport(PreviewHints hints)
 {
     Q_D(ReportEngine);
@@ -1806,9 +1959,9 @@ void ReportEngine::setShowDesignerModal(bool showDesignerModal)
 }
 
 ScriptEngineManager*LimeReport::ReportEnginePrivate::scriptManager(){
-    ScriptEngineManager::instance().setContext(scriptContext());
-    ScriptEngineManager::instance().setDataManager(dataManager());
-    return &ScriptEngineManager::instance();
+    m_scriptManager->setContext(scriptContext());
+    m_scriptManager->setDataManager(dataManager());
+    return m_scriptManager;
 }
 
 PrintProcessor::PrintProcessor(QPrinter* printer)
@@ -167,8 +167,7 @@ public:
     IDataSourceManager*  dataManagerIntf(){return m_datasources;}
 
     IScriptEngineManager* scriptManagerIntf(){
-        ScriptEngineManager::instance().setDataManager(dataManager());
-        return &ScriptEngineManager::instance();
+        return scriptManager();
     }
 
     void    clearReport();
@@ -178,6 +177,16 @@ public:
     void    printToFile(const QString& fileName);
     bool    printToPDF(const QString& fileName);
     bool    exportReport(QString exporterName, const QString &fileName = "", const QMap<QString, QVariant>& params = QMap<QString, QVariant>());
+    bool    renderToPageSink(IPageSink* pageSink);
+    bool    pageStreaming() const {return m_pageStreaming;}
+    void    setPageStreaming(bool value){m_pageStreaming = value;}
+    RenderMode renderMode() const {return m_renderMode;}
+    void    setRenderMode(RenderMode value){m_renderMode = value;}
+    int     eventsProcessingInterval() const {return m_eventsProcessingInterval;}
+    void    setEventsProcessingInterval(int msec){m_eventsProcessingInterval = msec;}
+    bool    templateCacheEnabled() const {return m_templateCacheEnabled;}
+    void    setTemplateCacheEnabled(bool value){m_templateCacheEnabled = value;}
+    bool    canStreamPages();
     void    previewReport(PreviewHints hints = PreviewBarsUserSetting);
     void    previewReport(QPrinter* printer, PreviewHints hints = PreviewBarsUserSetting);
 
@@ -305,7 +314,7 @@ private:
     Translations* translations(){ return &m_translations;}
     void updateTranslations();
     //ITranslationContainer
-    ReportPages renderToPages();
+    ReportPages renderToPages(IPageSink* pageSink = 0);
     ReportPages appendPages(ReportPages s1, ReportPages s2, AppendType appendType);
     QString renderToString();
     PageItemDesignIntf *getPageByName(const QString& pageName);
@@ -358,7 +367,13 @@ private:
     bool m_saveToFileVisible;
     bool m_printToPdfVisible;
     bool m_printVisible;
-    bool m_cancelPrinting;
+    bool m_pageStreaming;
+    QAtomicInt m_cancelPrinting;
+    QAtomicInt m_cancelRender;
+    RenderMode m_renderMode;
+    int m_eventsProcessingInterval;
+    bool m_templateCacheEnabled;
+    ScriptEngineManager* m_scriptManager;
 };
 
 }
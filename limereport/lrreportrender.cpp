@@ -29,6 +29,8 @@
  ****************************************************************************/
 #include <stdexcept>
 #include <QMessageBox>
+#include <QDataStream>
+#include <QMetaProperty>
 
 #include "lrglobal.h"
 #include "lrreportrender.h"
@@ -149,8 +151,8 @@ void ReportRender::renameChildItems(BaseDesignIntf *item){
 ReportRender::ReportRender(QObject *parent)
     :QObject(parent), m_renderPageItem(0), m_pageCount(0),
     m_lastRenderedHeader(0), m_lastDataBand(0), m_lastRenderedFooter(0),
-    m_lastRenderedBand(0), m_currentColumn(0), m_newPageStarted(false),
-    m_lostHeadersMoved(false)
+    m_lastRenderedBand(0), m_renderCanceled(&m_ownRenderCanceled), m_currentColumn(0), m_newPageStarted(false),
+    m_lostHeadersMoved(false), m_pageSink(0), m_streamedPagesCount(0)
 {
     initColumns();
 }
@@ -226,6 +228,7 @@ void ReportRender::analizeContainer(BaseDesignIntf* item, BandDesignIntf* band){
 
 void ReportRender::analizePage(PageItemDesignIntf* patternPage){
     m_groupfunctionItems.clear();
+    m_groupFunctionsContent.clear();
     foreach(BandDesignIntf* band, patternPage->bands()){
         if (band->isFooter() || band->isHeader()){
             analizeContainer(band,band);
@@ -237,6 +240,7 @@ void ReportRender::renderPage(PageItemDesignIntf* patternPage, bool isTOC, bool
 {
     m_currentNameIndex = 0;
     m_patternPageItem = patternPage;
+    m_bandRenderPlans.clear();
 
     analizePage(patternPage);
 
@@ -248,7 +252,7 @@ void ReportRender::renderPage(PageItemDesignIntf* patternPage, bool isTOC, bool
         m_pagesRanges.startNewRange();
     }
 
-    m_renderCanceled = false;
+    m_eventsProcessor.start();
     BandDesignIntf* reportFooter = m_patternPageItem->bandByType(BandDesignIntf::ReportFooter);
     m_reportFooterHeight = 0;
     if (reportFooter)
@@ -259,7 +263,6 @@ void ReportRender::renderPage(PageItemDesignIntf* patternPage, bool isTOC, bool
 
     try{
         datasources()->setAllDatasourcesToFirst();
-        datasources()->clearGroupFuntionsExpressions();
     } catch(ReportError &exception){
         //TODO possible should thow exeption
         QMessageBox::critical(0,tr("Error"),exception.what());
@@ -272,7 +275,7 @@ void ReportRender::renderPage(PageItemDesignIntf* patternPage, bool isTOC, bool
     renderReportHeader(m_patternPageItem, AfterPageHeader);
 
     BandDesignIntf* lastRenderedBand = 0;
-    for (int i=0;i<m_patternPageItem->dataBandCount() && !m_renderCanceled; i++){
+    for (int i=0;i<m_patternPageItem->dataBandCount() && !isRenderCanceled(); i++){
         lastRenderedBand = m_patternPageItem->dataBandAt(i);
         initDatasource(lastRenderedBand->datasourceName());
         renderDataBand(lastRenderedBand);
@@ -289,6 +292,7 @@ void ReportRender::renderPage(PageItemDesignIntf* patternPage, bool isTOC, bool
         renderBand(tearOffBand, 0, StartNewPageAsNeeded);
 
     savePage(true);
+    streamRenderedPages();
 
 }
 
@@ -330,7 +334,7 @@ void ReportRender::initRenderPage()
         m_renderPageItem->setPatternItem(m_patternPageItem);
 
         ScriptValueType svCurrentPage;
-        ScriptEngineType* se = ScriptEngineManager::instance().scriptEngine();
+        ScriptEngineType* se = ScriptEngineManager::forDataManager(m_datasources).scriptEngine();
 
 #ifdef USE_QJSENGINE
         svCurrentPage = getJSValue(*se, m_renderPageItem);
@@ -476,6 +480,14 @@ void ReportRender::extractGroupFuntionsFromItem(ContentItemDesignIntf* contentIt
         }
     }    
 #endif
+    if (contentItem && m_groupfunctionItems.contains(contentItem->patternName())){
+        GroupFunctionsContent& prepared = m_groupFunctionsContent[contentItem->patternName()];
+        prepared.bandName = band->objectName();
+        prepared.source = contentItem->content();
+        prepared.content = replaceGroupFunctions(
+            prepared.source, m_groupfunctionItems.value(contentItem->patternName()), prepared.bandName
+        );
+    }
 }
 
 void ReportRender::extractGroupFunctionsFromContainer(BaseDesignIntf* baseItem, BandDesignIntf* band){
@@ -493,63 +505,74 @@ void ReportRender::extractGroupFunctions(BandDesignIntf *band)
     extractGroupFunctionsFromContainer(band, band);
 }
 
-void ReportRender::replaceGroupFunctionsInItem(ContentItemDesignIntf* contentItem, BandDesignIntf* band){
-    if (contentItem){
-        if (m_groupfunctionItems.contains(contentItem->patternName())){
-            QString content = contentItem->content();
-            foreach(QString functionName, m_groupfunctionItems.value(contentItem->patternName())){
+QString ReportRender::replaceGroupFunctions(QString content, const QVector<QString>& functions, const QString& bandName){
+    foreach(QString functionName, functions){
 #if QT_VERSION >= QT_VERSION_CHECK(5, 15, 1)
-                QRegularExpression rx = getGroupFunctionRegEx(functionName);
-                QRegularExpressionMatch match = rx.match(content);
-
-                if (match.capturedStart() != -1){
-                    int pos = 0;
-                    while ( (pos = match.capturedStart()) != -1 ){
-                        QVector<QString> captures = normalizeCaptures(match);
-                        if (captures.size() >= 3){
-                            QString expressionIndex = datasources()->putGroupFunctionsExpressions(captures.at(Const::VALUE_INDEX));
-                            if (captures.size()<5){
-                                content.replace(captures.at(0), QString("%1(%2,%3)")
-                                    .arg(functionName).arg('"'+expressionIndex+'"').arg('"'+band->objectName()+'"'));
-                            } else {
-                                content.replace(captures.at(0), QString("%1(%2,%3,%4)").arg(
-                                                    functionName,
-                                                    '"'+expressionIndex+'"',
-                                                    '"'+band->objectName()+'"',
-                                                    captures.at(4)
-                                                ));
-                            }
-                        }
-                        match = rx.match(content, pos + match.capturedLength());
+        QRegularExpression rx = getGroupFunctionRegEx(functionName);
+        QRegularExpressionMatch match = rx.match(content);
+
+        if (match.capturedStart() != -1){
+            int pos = 0;
+            while ( (pos = match.capturedStart()) != -1 ){
+                QVector<QString> captures = normalizeCaptures(match);
+                if (captures.size() >= 3){
+                    QString expressionIndex = datasources()->putGroupFunctionsExpressions(captures.at(Const::VALUE_INDEX));
+                    if (captures.size()<5){
+                        content.replace(captures.at(0), QString("%1(%2,%3)")
+                            .arg(functionName).arg('"'+expressionIndex+'"').arg('"'+bandName+'"'));
+                    } else {
+                        content.replace(captures.at(0), QString("%1(%2,%3,%4)").arg(
+                                            functionName,
+                                            '"'+expressionIndex+'"',
+                                            '"'+bandName+'"',
+                                            captures.at(4)
+                                        ));
                     }
                 }
+                match = rx.match(content, pos + match.capturedLength());
+            }
+        }
 #else
-                QRegExp rx(QString(Const::GROUP_FUNCTION_RX).arg(functionName));
-                rx.setMinimal(true);
-                if (rx.indexIn(content)>=0){
-                    int pos = 0;
-                    while ( (pos = rx.indexIn(content,pos))!= -1 ){
-                        QVector<QString> captures = normalizeCaptures(rx);
-                        if (captures.size() >= 3){
-                            QString expressionIndex = datasources()->putGroupFunctionsExpressions(captures.at(Const::VALUE_INDEX));
-                            if (captures.size()<5){
-                                content.replace(captures.at(0),QString("%1(%2,%3)").arg(functionName).arg('"'+expressionIndex+'"').arg('"'+band->objectName()+'"'));
-                            } else {
-                                content.replace(captures.at(0),QString("%1(%2,%3,%4)").arg(
-                                                    functionName,
-                                                    '"'+expressionIndex+'"',
-                                                    '"'+band->objectName()+'"',
-                                                    captures.at(4)
-                                                ));
-                            }
-                        }
-                        pos += rx.matchedLength();
+        QRegExp rx(QString(Const::GROUP_FUNCTION_RX).arg(functionName));
+        rx.setMinimal(true);
+        if (rx.indexIn(content)>=0){
+            int pos = 0;
+            while ( (pos = rx.indexIn(content,pos))!= -1 ){
+                QVector<QString> captures = normalizeCaptures(rx);
+                if (captures.size() >= 3){
+                    QString expressionIndex = datasources()->putGroupFunctionsExpressions(captures.at(Const::VALUE_INDEX));
+                    if (captures.size()<5){
+                        content.replace(captures.at(0),QString("%1(%2,%3)").arg(functionName).arg('"'+expressionIndex+'"').arg('"'+bandName+'"'));
+                    } else {
+                        content.replace(captures.at(0),QString("%1(%2,%3,%4)").arg(
+                                            functionName,
+                                            '"'+expressionIndex+'"',
+                                            '"'+bandName+'"',
+                                            captures.at(4)
+                                        ));
                     }
                 }
+                pos += rx.matchedLength();
+            }
+        }
 
 #endif
+    }
+    return content;
+}
+
+void ReportRender::replaceGroupFunctionsInItem(ContentItemDesignIntf* contentItem, BandDesignIntf* band){
+    if (contentItem){
+        if (m_groupfunctionItems.contains(contentItem->patternName())){
+            GroupFunctionsContent& prepared = m_groupFunctionsContent[contentItem->patternName()];
+            if (prepared.bandName != band->objectName() || prepared.source != contentItem->content()){
+                prepared.bandName = band->objectName();
+                prepared.source = contentItem->content();
+                prepared.content = replaceGroupFunctions(
+                    prepared.source, m_groupfunctionItems.value(contentItem->patternName()), prepared.bandName
+                );
             }
-            contentItem->setContent(content);
+            contentItem->setContent(prepared.content);
         }
     }
 }
@@ -581,7 +604,7 @@ QColor ReportRender::makeBackgroundColor(BandDesignIntf* band){
 
 BandDesignIntf* ReportRender::renderBand(BandDesignIntf *patternBand, BandDesignIntf* bandData, ReportRender::DataRenderMode mode, bool isLast)
 {
-    QCoreApplication::processEvents();
+    m_eventsProcessor.processEvents();
     bool bandIsSliced = false;
     if (patternBand){
 
@@ -651,7 +674,9 @@ BandDesignIntf* ReportRender::renderBand(BandDesignIntf *patternBand, BandDesign
                             } else {
                                 savePage();
                                 startNewPage();
-                                if (!bandIsSliced){
+                                // a clone which does not depend on the page keeps its height
+                                // and is placed on the new page as it is
+                                if (!bandIsSliced && bandRenderPlan(patternBand)->isPageDependent()){
                                     BandDesignIntf* t = renderData(patternBand, false);
                                     t->copyBandAttributes(bandClone);
                                     patternBand->emitBandReRendered(bandClone, t);
@@ -704,7 +729,7 @@ void ReportRender::renderDataBand(BandDesignIntf *dataBand)
 
     if (header && header->printAlways()) renderDataHeader(header);
 
-    if(bandDatasource && !bandDatasource->eof() && !m_renderCanceled){
+    if(bandDatasource && !bandDatasource->eof() && !isRenderCanceled()){
 
         QString varName = QLatin1String("line_")+dataBand->objectName().toLower();
         datasources()->setReportVariable(varName,1);
@@ -717,10 +742,23 @@ void ReportRender::renderDataBand(BandDesignIntf *dataBand)
 
         renderGroupHeader(dataBand, bandDatasource, true);
 
+        QStringList groupLineVars;
+        QList<BandDesignIntf *> bandList = dataBand->childrenByType(BandDesignIntf::GroupHeader);
+        while (bandList.size() > 0)
+        {
+            QList<BandDesignIntf *> childList;
+            foreach (BandDesignIntf* band, bandList)
+            {
+                childList.append(band->childrenByType(BandDesignIntf::GroupHeader));
+                groupLineVars.append(QLatin1String("line_")+band->objectName().toLower());
+            }
+            bandList = childList;
+        }
+
         bool firstTime = true;
 
 
-        while(!bandDatasource->eof() && !m_renderCanceled){
+        while(!bandDatasource->eof() && !isRenderCanceled()){
 
             datasources()->updateChildrenData(dataBand->datasourceName());
 
@@ -754,22 +792,10 @@ void ReportRender::renderDataBand(BandDesignIntf *dataBand)
 
             datasources()->setReportVariable(varName,datasources()->variable(varName).toInt()+1);
 
-            QList<BandDesignIntf *> bandList;
-            QList<BandDesignIntf *> childList;
-
-            bandList = dataBand->childrenByType(BandDesignIntf::GroupHeader);
-            while (bandList.size() > 0)
+            foreach (const QString& groupLineVar, groupLineVars)
             {
-                childList.clear();
-                foreach (BandDesignIntf* band, bandList)
-                {
-                    childList.append(band->childrenByType(BandDesignIntf::GroupHeader));
-
-                    QString groupLineVar = QLatin1String("line_")+band->objectName().toLower();
-                    if (datasources()->containsVariable(groupLineVar))
-                        datasources()->setReportVariable(groupLineVar,datasources()->variable(groupLineVar).toInt()+1);
-                }
-                bandList = childList;
+                if (datasources()->containsVariable(groupLineVar))
+                    datasources()->setReportVariable(groupLineVar,datasources()->variable(groupLineVar).toInt()+1);
             }
 
             renderGroupHeader(dataBand, bandDatasource, false);
@@ -842,6 +868,8 @@ void ReportRender::renderPageFooter(PageItemDesignIntf *patternPage)
         for(int i=0;i<m_maxHeightByColumn.size();++i)
             m_maxHeightByColumn[i]+=m_pageFooterHeight;
         m_renderPageItem->setPageFooter(bandClone);
+        if (bandClone->hasSecondPassContent())
+            m_renderPageItem->addSecondPassItem(bandClone);
         registerBand(bandClone);
         datasources()->clearGroupFunctionValues(band->objectName());
     }
@@ -862,6 +890,8 @@ void ReportRender::renderPageItems(PageItemDesignIntf* patternPage)
     m_renderPageItem->restoreLinks();
     m_renderPageItem->updateSubItemsSize(FirstPass,m_datasources);
     foreach(BaseDesignIntf* item, pageItems){
+        if (item->hasSecondPassContent())
+            m_renderPageItem->addSecondPassItem(item);
         if (!item->isWatermark())
             item->setZValue(item->zValue()-100000);
         else
@@ -1027,6 +1057,7 @@ void ReportRender::renderGroupFooter(BandDesignIntf *parentBand)
 void ReportRender::initGroups()
 {
     m_datasources->clearGroupFunction();
+    m_datasources->clearGroupFuntionsExpressions();
     foreach(BandDesignIntf* band, m_patternPageItem->childBands()){
         if (band->isFooter()) extractGroupFunctions(band);
         if (band->isHeader()){
@@ -1037,34 +1068,32 @@ void ReportRender::initGroups()
     }
 }
 
-void ReportRender::popPageFooterGroupValues(BandDesignIntf *dataBand)
+void ReportRender::popPageFooterGroupValues(BandDesignIntf *band)
 {
     BandDesignIntf* pageFooter = m_patternPageItem->bandByType(BandDesignIntf::PageFooter);
     if (pageFooter){
         foreach(GroupFunction* gf, datasources()->groupFunctionsByBand(pageFooter->objectName())){
-            if ((gf->dataBandName()==dataBand->objectName())){
-                // FIXME Probably coincidence Field and Variables
-                if ((!m_popupedExpression.contains(dataBand))||(!m_popupedExpression.values(dataBand).contains(gf->data()))){
-                    m_popupedExpression.insert(dataBand,gf->data());
-                    m_popupedValues.insert(QString("%1").arg((quintptr)dataBand)+'|'+gf->data(), gf->values()[gf->values().count()-1]);
-                    gf->values().pop_back();
-                }
+            // only the functions which took a value from the band are rolled back
+            QHash<GroupFunction*, QVariant>::const_iterator value = band->groupFunctionValues().constFind(gf);
+            if (value == band->groupFunctionValues().constEnd()) continue;
+            QPair<BandDesignIntf*, GroupFunction*> key(band, gf);
+            if (!m_popupedValues.contains(key)){
+                m_popupedValues.insert(key, value.value());
+                gf->popValue();
             }
         }
     }
 }
 
-void ReportRender::pushPageFooterGroupValues(BandDesignIntf *dataBand)
+void ReportRender::pushPageFooterGroupValues(BandDesignIntf *band)
 {
     BandDesignIntf* pageFooter = m_patternPageItem->bandByType(BandDesignIntf::PageFooter);
     if (pageFooter){
         foreach(GroupFunction* gf, datasources()->groupFunctionsByBand(pageFooter->objectName())){
-            if ((gf->dataBandName()==dataBand->objectName())){
-                // FIXME Probably coincidence Field and Variables
-                if ((m_popupedExpression.contains(dataBand))&&(m_popupedExpression.values(dataBand).contains(gf->data()))){
-                    gf->values().push_back(m_popupedValues.value(QString("%1").arg((quintptr)dataBand)+'|'+gf->data()));
-                }
-            }
+            QHash<QPair<BandDesignIntf*, GroupFunction*>, QVariant>::const_iterator it =
+                    m_popupedValues.constFind(qMakePair(band, gf));
+            if (it != m_popupedValues.constEnd())
+                gf->pushValue(it.value());
         }
     }
 }
@@ -1084,6 +1113,7 @@ void ReportRender::closeGroup(BandDesignIntf *band)
     }
 
     m_childBands.remove(band);
+    attachPendingBands();
 }
 
 void ReportRender::openDataGroup(BandDesignIntf *band)
@@ -1137,7 +1167,7 @@ qreal minVectorValue(QVector<qreal> vector){
     return curValue;
 }
 
-void ReportRender::placeBandOnPage(BandDesignIntf* band, int columnIndex){
+void ReportRender::placeBandOnPage(BandDesignIntf* band, int columnIndex, bool attach){
 
     qreal bandPos = m_currentStartDataPos[columnIndex];
 
@@ -1147,10 +1177,60 @@ void ReportRender::placeBandOnPage(BandDesignIntf* band, int columnIndex){
     band->setBandIndex(++m_currentIndex);
     band->setColumnIndex(columnIndex);
 
-    m_renderPageItem->registerBand(band);
+    if (attach)
+        attachBand(band);
+    else
+        m_pendingBands.append(band);
     m_currentColumn = columnIndex;
 }
 
+void ReportRender::attachBand(BandDesignIntf* band)
+{
+    m_renderPageItem->registerBand(band);
+    if (band->hasSecondPassContent())
+        m_renderPageItem->addSecondPassItem(band);
+}
+
+void ReportRender::attachPendingBands(bool all)
+{
+    // a pending band has its place on the page but is added to the page only
+    // when no group it belongs to has to be kept together any more
+    QList<BandDesignIntf*>::iterator it = m_pendingBands.begin();
+    while (it != m_pendingBands.end()){
+        if (all || !isInKeptTogetherGroup(*it)){
+            attachBand(*it);
+            it = m_pendingBands.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool ReportRender::isInKeptTogetherGroup(BandDesignIntf* band)
+{
+    foreach(GroupBandsHolder* holder, m_childBands.values()){
+        if (holder->tryToKeepTogether() && holder->contains(band)) return true;
+    }
+    return false;
+}
+
+bool ReportRender::hasKeptTogetherGroup()
+{
+    foreach(GroupBandsHolder* holder, m_childBands.values()){
+        if (holder->tryToKeepTogether()) return true;
+    }
+    return false;
+}
+
+bool ReportRender::canBeGrouped(BandDesignIntf* band)
+{
+    return band->bandType()!=BandDesignIntf::PageHeader &&
+           band->bandType()!=BandDesignIntf::PageFooter &&
+           band->bandType()!=BandDesignIntf::ReportHeader &&
+           band->bandType()!=BandDesignIntf::ReportFooter &&
+           !band->reprintOnEachPage();
+}
+
 bool isMultiColumnHeader(BandDesignIntf* band){
     return ( (band->columnsCount() > 1 ) &&
              (band->isHeader() &&
@@ -1202,6 +1282,9 @@ bool ReportRender::registerBand(BandDesignIntf *band, bool registerInChildren)
 
     m_currentColumn = m_currentColumn == -1 ? 0: m_currentColumn;
 
+    // bands of a kept together group wait until the whole group has been placed
+    bool pending = registerInChildren && canBeGrouped(band) && hasKeptTogetherGroup();
+
     if (  (band->height() <= m_maxHeightByColumn[m_currentColumn]) ||
           m_patternPageItem->endlessHeight() ||
           (isMultiColumnHeader(band) && (band->height() <= m_maxHeightByColumn[0]))
@@ -1215,20 +1298,22 @@ bool ReportRender::registerBand(BandDesignIntf *band, bool registerInChildren)
         if ( isMultiColumnHeader(band)){
 
             if (!band->parent()){
-                for (int i = 0; i < band->columnsCount(); ++i){
+                int columnsCount = band->columnsCount();
+                for (int i = 0; i < columnsCount; ++i){
                     m_currentColumn = i;
                     if (i != 0) band = dynamic_cast<BandDesignIntf*>(band->cloneItem(PreviewMode));
-                    placeBandOnPage(band, i);
+                    // only the last copy is added to the groups
+                    placeBandOnPage(band, i, !pending || i != columnsCount - 1);
                 }
             } else {
-                placeBandOnPage(band, band->columnIndex());
+                placeBandOnPage(band, band->columnIndex(), !pending);
             }
 
 
         } else {
 
             if (band->bandType() != BandDesignIntf::PageFooter){
-                placeBandOnPage(band, m_currentColumn);
+                placeBandOnPage(band, m_currentColumn, !pending);
             }
 
             if (band->columnsCount() > 1){
@@ -1238,14 +1323,7 @@ bool ReportRender::registerBand(BandDesignIntf *band, bool registerInChildren)
         }
 
         foreach(QList<BandDesignIntf*>* list, m_childBands.values()){
-            if (registerInChildren &&
-                band->bandType()!=BandDesignIntf::PageHeader &&
-                band->bandType()!=BandDesignIntf::PageFooter &&
-                band->bandType()!=BandDesignIntf::ReportHeader &&
-                band->bandType()!=BandDesignIntf::ReportFooter &&
-                !list->contains(band) &&
-                !band->reprintOnEachPage()
-            )
+            if (registerInChildren && canBeGrouped(band) && !list->contains(band))
                 list->append(band);
         }
 
@@ -1324,14 +1402,79 @@ void ReportRender::secondRenderPass(ReportPages renderedPages)
     }
 
     for(int i = 0; i < renderedPages.count(); ++i){
-        PageItemDesignIntf::Ptr page = renderedPages.at(i);
-        m_datasources->setReportVariable("#PAGE",m_pagesRanges.findPageNumber(i));
-        m_datasources->setReportVariable("#PAGE_COUNT",m_pagesRanges.findLastPageNumber(i));
-        foreach(BaseDesignIntf* item, page->childBaseItems()){
-            if (item->isNeedUpdateSize(SecondPass))
-                item->updateItemSize(m_datasources, SecondPass);
+        if (isNeedSecondPass(renderedPages.at(i).data()))
+            renderSecondPass(renderedPages.at(i).data(), i);
+    }
+}
+
+void ReportRender::renderSecondPass(PageItemDesignIntf* page, int pageIndex)
+{
+    m_datasources->setReportVariable("#PAGE",m_pagesRanges.findPageNumber(pageIndex));
+    m_datasources->setReportVariable("#PAGE_COUNT",m_pagesRanges.findLastPageNumber(pageIndex));
+    foreach(BaseDesignIntf* item, page->secondPassItems()){
+        if (item->isNeedUpdateSize(SecondPass))
+            item->updateItemSize(m_datasources, SecondPass);
+    }
+}
+
+bool ReportRender::isNeedSecondPass(PageItemDesignIntf* page)
+{
+    return !page->secondPassItems().isEmpty();
+}
+
+void ReportRender::setPageSink(IPageSink* pageSink)
+{
+    m_pageSink = pageSink;
+    m_streamedPagesCount = 0;
+    m_pagesSpool.clear();
+}
+
+void ReportRender::streamRenderedPages()
+{
+    // Pages are handed over only when nothing can touch them anymore, i.e. after
+    // lost headers have been moved to the next page. A page which still has
+    // second pass content waits in the spool until its pages range is closed,
+    // and so do all pages after it to keep the order.
+    if (!m_pageSink) return;
+    foreach(PageItemDesignIntf::Ptr page, m_renderedPages){
+        int pageIndex = m_streamedPagesCount++;
+        if (m_pagesSpool.isEmpty() && !isNeedSecondPass(page.data())){
+            if (!m_pageSink->putPage(page))
+                m_renderCanceled->storeRelease(1);
+        } else {
+            m_pagesSpool.append(pageIndex, page);
+        }
+    }
+    m_renderedPages.clear();
+}
+
+void ReportRender::flushPagesSpool()
+{
+    if (!m_pageSink || m_pagesSpool.isEmpty()) return;
+
+    QVariant currentPage = m_datasources->variable("#PAGE");
+    QVariant currentPageCount = m_datasources->variable("#PAGE_COUNT");
+
+    while (!m_pagesSpool.isEmpty()){
+        PageItemDesignIntf::Ptr page;
+        int pageIndex = m_pagesSpool.takeFirst(page);
+        if (page.isNull()){
+            m_datasources->putError(tr("Can't restore spooled page %1").arg(pageIndex+1));
+            continue;
         }
+        renderSecondPass(page.data(), pageIndex);
+        if (!m_pageSink->putPage(page))
+            m_renderCanceled->storeRelease(1);
     }
+
+    m_datasources->setReportVariable("#PAGE", currentPage);
+    m_datasources->setReportVariable("#PAGE_COUNT", currentPageCount);
+}
+
+void ReportRender::finishPageStream()
+{
+    streamRenderedPages();
+    flushPagesSpool();
 }
 
 void ReportRender::createTOCMarker(bool startNewRange)
@@ -1382,7 +1525,7 @@ BandDesignIntf *ReportRender::saveUppperPartReturnBottom(BandDesignIntf *band, i
 
 BandDesignIntf *ReportRender::renderData(BandDesignIntf *patternBand, bool emitBeforeRender)
 {
-    BandDesignIntf* bandClone = dynamic_cast<BandDesignIntf*>(patternBand->cloneItem(PreviewMode));
+    BandDesignIntf* bandClone = bandRenderPlan(patternBand)->instantiate(PreviewMode);
 
     m_scriptEngineContext->baseDesignIntfToScript(patternBand->parent()->objectName(), bandClone);
     m_scriptEngineContext->setCurrentBand(bandClone);
@@ -1407,6 +1550,16 @@ BandDesignIntf *ReportRender::renderData(BandDesignIntf *patternBand, bool emitB
     return bandClone;
 }
 
+BandRenderPlan::Ptr ReportRender::bandRenderPlan(BandDesignIntf* patternBand)
+{
+    BandRenderPlan::Ptr plan = m_bandRenderPlans.value(patternBand);
+    if (plan.isNull()){
+        plan = BandRenderPlan::Ptr(new BandRenderPlan(patternBand));
+        m_bandRenderPlans.insert(patternBand, plan);
+    }
+    return plan;
+}
+
 void ReportRender::startNewColumn(){
     if (m_currentColumn < m_maxHeightByColumn.size()-1){
         m_currentColumn++;
@@ -1450,35 +1603,19 @@ void ReportRender::startNewPage(bool isFirst)
     }
 
     checkLostHeadersOnPrevPage();
+    streamRenderedPages();
     pasteGroups();
 
 }
 
 void ReportRender::resetPageNumber(ResetPageNuberType resetType)
 {
+    flushPagesSpool();
     m_pagesRanges.startNewRange();
     if (resetType == PageReset)
         m_datasources->setReportVariable("#PAGE",1);
 }
 
-void ReportRender::cutGroups()
-{
-    m_popupedExpression.clear();
-    m_popupedValues.clear();
-    //foreach(BandDesignIntf* groupBand,m_childBands.keys()){
-    foreach(BandDesignIntf* groupBand, m_childBands.keys()){
-        if (m_childBands.value(groupBand)->tryToKeepTogether()){
-            foreach(BandDesignIntf* band, *m_childBands.value(groupBand)){
-                m_renderPageItem->removeBand(band);
-                popPageFooterGroupValues(band);
-                band->setParent(0);
-                band->setParentItem(0);
-            }
-        }
-    }
-
-}
-
 void ReportRender::checkFooterGroup(BandDesignIntf *groupBand)
 {
     if (m_childBands.contains(groupBand)){
@@ -1494,9 +1631,11 @@ void ReportRender::checkFooterGroup(BandDesignIntf *groupBand)
 
 void ReportRender::pasteGroups()
 {
-    BandDesignIntf* groupBand = findEnclosingGroup();
-    if (groupBand){
-        foreach(BandDesignIntf* band, *m_childBands.value(groupBand)){
+    // bands of kept together groups which didn't fit on the previous page
+    if (!m_pendingBands.isEmpty()){
+        QList<BandDesignIntf*> bands = m_pendingBands;
+        m_pendingBands.clear();
+        foreach(BandDesignIntf* band, bands){
             registerBand(band,false);
             if (band->isData()) m_renderedDataBandCount++;
             pushPageFooterGroupValues(band);
@@ -1504,7 +1643,6 @@ void ReportRender::pasteGroups()
         foreach(GroupBandsHolder* holder, m_childBands.values())
             holder->setTryToKeepTogether(false);
     }
-    m_popupedExpression.clear();
     m_popupedValues.clear();
 }
 
@@ -1590,23 +1728,6 @@ void ReportRender::checkLostHeadersInPrevColumn()
     }
 }
 
-BandDesignIntf* ReportRender::findEnclosingGroup()
-{
-    BandDesignIntf* result=0;
-    int groupIndex = -1;
-    if (!m_childBands.isEmpty()){
-        foreach(BandDesignIntf* gb, m_childBands.keys()){
-            if (m_childBands.value(gb)->tryToKeepTogether()&&
-                ((gb->bandIndex()<groupIndex)||(groupIndex==-1))
-            ){
-                result=gb;
-                groupIndex=result->bandIndex();
-            }
-        }
-    }
-    return result;
-}
-
 void ReportRender::savePage(bool isLast)
 {
 
@@ -1623,7 +1744,12 @@ void ReportRender::savePage(bool isLast)
         m_pagesRanges.addPage();
 
     checkFooterGroup(m_lastDataBand);
-    cutGroups();
+    // the bands of groups which are still kept together never get on this page,
+    // they are placed on the next one by pasteGroups()
+    attachPendingBands(isLast);
+    m_popupedValues.clear();
+    foreach(BandDesignIntf* band, m_pendingBands)
+        popPageFooterGroupValues(band);
     rearrangeColumnsItems();
     m_columnedBandItems.clear();
 
@@ -1691,7 +1817,262 @@ ReportRender::~ReportRender(){
 }
 
 void ReportRender::cancelRender(){
-    m_renderCanceled = true;
+    m_renderCanceled->storeRelease(1);
+}
+
+void BandRenderPlan::removePropertyValue(BaseDesignIntf::PropertyValues& values, int propertyIndex)
+{
+    for (int i = values.size() - 1; i >= 0; --i){
+        if (values.at(i).first == propertyIndex)
+            values.remove(i);
+    }
+}
+
+BaseDesignIntf::PropertyValues BandRenderPlan::mergePropertyValues(const BaseDesignIntf::PropertyValues& values1,
+                                                                   const BaseDesignIntf::PropertyValues& values2)
+{
+    BaseDesignIntf::PropertyValues result;
+    result.reserve(values1.size() + values2.size());
+    int i = 0, j = 0;
+    while (i < values1.size() || j < values2.size()){
+        if (j == values2.size() || (i < values1.size() && values1.at(i).first < values2.at(j).first))
+            result.append(values1.at(i++));
+        else
+            result.append(values2.at(j++));
+    }
+    return result;
+}
+
+BandRenderPlan::BandRenderPlan(BandDesignIntf* patternBand)
+    : m_patternBand(patternBand), m_pageDependent(false), m_pageDependencyValid(false)
+{
+    compile(patternBand);
+}
+
+int BandRenderPlan::compile(BaseDesignIntf* item)
+{
+    int index = m_items.size();
+    ItemPlan itemPlan;
+    itemPlan.patternItem = item;
+    if (dynamic_cast<ContentItemDesignIntf*>(item))
+        itemPlan.contentProperty = item->metaObject()->indexOfProperty("content");
+    m_items.append(itemPlan);
+
+    QVector<int> children;
+#ifdef HAVE_QT5
+    foreach(QObject* child, item->children()){
+#else
+    foreach(QObject* child, item->QObject::children()){
+#endif
+        BaseDesignIntf* childItem = dynamic_cast<BaseDesignIntf*>(child);
+        if (childItem) children.append(compile(childItem));
+    }
+    m_items[index].children = children;
+    return index;
+}
+
+BandDesignIntf* BandRenderPlan::instantiate(BaseDesignIntf::ItemMode mode, QObject* owner, QGraphicsItem* parent)
+{
+    return dynamic_cast<BandDesignIntf*>(instantiateItem(0, mode, owner, parent));
+}
+
+bool BandRenderPlan::isPageDependent()
+{
+    // The result is kept until an item of the pattern band changes, the same
+    // way as the cached property values.
+    if (m_patternBand->isRenderSignalsConnected()) return true;
+    for (int i = 0; i < m_items.size() && m_pageDependencyValid; ++i){
+        if (m_items.at(i).dependencyRevision != m_items.at(i).patternItem->propertiesRevision())
+            m_pageDependencyValid = false;
+    }
+    if (!m_pageDependencyValid){
+        m_pageDependent = checkPageDependency();
+        for (int i = 0; i < m_items.size(); ++i)
+            m_items[i].dependencyRevision = m_items.at(i).patternItem->propertiesRevision();
+        m_pageDependencyValid = true;
+    }
+    return m_pageDependent;
+}
+
+bool BandRenderPlan::checkPageDependency() const
+{
+    // Only data fields give the same result on any page, variables and
+    // scripts can refer to the page or be changed by page events.
+#if QT_VERSION < QT_VERSION_CHECK(5, 15, 1)
+    QRegExp rx(Const::FIELD_RX);
+#else
+    QRegularExpression rx = getFieldRegEx();
+#endif
+    foreach(const ItemPlan& itemPlan, m_items){
+        // besides the content, any text property can bind an item to a variable
+        // or a script, e.g. the variable of an image
+        BaseDesignIntf* item = itemPlan.patternItem;
+        const QMetaObject* metaObject = item->metaObject();
+        for (int i = 0; i < metaObject->propertyCount(); ++i){
+            QMetaProperty metaProperty = metaObject->property(i);
+            if (metaProperty.userType() != QMetaType::QString) continue;
+            QString value = metaProperty.read(item).toString();
+            if (value.isEmpty()) continue;
+            if (qstrcmp(metaProperty.name(), "variable") == 0) return true;
+            if (value.contains('$') && value.remove(rx).contains('$'))
+                return true;
+        }
+    }
+    return false;
+}
+
+BaseDesignIntf* BandRenderPlan::instantiateItem(int index, BaseDesignIntf::ItemMode mode, QObject* owner, QGraphicsItem* parent)
+{
+    // Does the same as BaseDesignIntf::cloneItem() but takes the item tree and
+    // the property values from the plan. The values of properties whose setters
+    // report a change are cached until the revision of the pattern item changes,
+    // the content and the other properties are read for every row.
+    ItemPlan& itemPlan = m_items[index];
+    BaseDesignIntf* pattern = itemPlan.patternItem;
+    if (itemPlan.revision != pattern->propertiesRevision()){
+        itemPlan.properties = pattern->changedProperties(mode, true);
+        removePropertyValue(itemPlan.properties, itemPlan.contentProperty);
+        itemPlan.revision = pattern->propertiesRevision();
+    }
+    BaseDesignIntf::PropertyValues unreported = pattern->changedProperties(mode, false);
+    removePropertyValue(unreported, itemPlan.contentProperty);
+    if (unreported != itemPlan.unreported){
+        itemPlan.unreported = unreported;
+        m_pageDependencyValid = false;
+    }
+
+    BaseDesignIntf* clone = pattern->createSameTypeItem(owner, parent);
+    clone->setObjectName(pattern->objectName());
+    clone->setItemMode(mode);
+    clone->objectLoadStarted();
+    clone->setReportSettings(pattern->reportSettings());
+    // written in declaration order like copyPropertiesFrom() does
+    clone->writeProperties(mergePropertyValues(itemPlan.properties, unreported));
+    if (itemPlan.contentProperty != -1){
+        QMetaProperty contentProperty = pattern->metaObject()->property(itemPlan.contentProperty);
+        contentProperty.write(clone, contentProperty.read(pattern));
+    }
+    clone->objectLoadFinished();
+    clone->setPatternName(pattern->objectName());
+    clone->setPatternItem(pattern);
+
+    foreach(int childIndex, itemPlan.children){
+        clone->childAddedEvent(instantiateItem(childIndex, mode, clone, clone));
+    }
+    return clone;
+}
+
+void PagesSpool::append(int pageIndex, PageItemDesignIntf::Ptr page)
+{
+    if (m_spilledPages.isEmpty() && m_pages.size() < m_maxPagesInMemory){
+        m_pages.append(qMakePair(pageIndex, page));
+        return;
+    }
+
+    if (m_file.isNull()){
+        m_file.reset(new QTemporaryFile());
+        if (!m_file->open()){
+            m_file.reset();
+            m_pages.append(qMakePair(pageIndex, page));
+            return;
+        }
+    }
+
+    QScopedPointer<ItemsWriterIntf> writer(new XMLWriter());
+    writer->putItem(page.data());
+    QByteArray data = writer->saveToByteArray();
+    QByteArray backups = saveContentBackups(page.data());
+
+    SpilledPage spilledPage;
+    spilledPage.pageIndex = pageIndex;
+    spilledPage.offset = m_file->size();
+    spilledPage.size = data.size();
+    spilledPage.backupsSize = backups.size();
+    m_file->seek(spilledPage.offset);
+    if (m_file->write(data) != data.size() || m_file->write(backups) != backups.size()){
+        m_file->resize(spilledPage.offset);
+        m_pages.append(qMakePair(pageIndex, page));
+        return;
+    }
+    m_spilledPages.append(spilledPage);
+}
+
+int PagesSpool::takeFirst(PageItemDesignIntf::Ptr& page)
+{
+    if (!m_pages.isEmpty()){
+        QPair<int, PageItemDesignIntf::Ptr> item = m_pages.takeFirst();
+        page = item.second;
+        return item.first;
+    }
+
+    page.clear();
+    if (m_spilledPages.isEmpty()) return -1;
+
+    SpilledPage spilledPage = m_spilledPages.takeFirst();
+    m_file->seek(spilledPage.offset);
+    QByteArray data = m_file->read(spilledPage.size);
+    QByteArray backups = m_file->read(spilledPage.backupsSize);
+    ItemsReaderIntf::Ptr reader = ByteArrayXMLReader::create(&data);
+    if (reader->first()){
+        PageItemDesignIntf::Ptr restoredPage = PageItemDesignIntf::create(0);
+        if (reader->readItem(restoredPage.data()) && restoreContentBackups(restoredPage.data(), backups)){
+            restoredPage->collectSecondPassItems();
+            page = restoredPage;
+        }
+    }
+
+    if (m_spilledPages.isEmpty())
+        m_file->resize(0);
+
+    return spilledPage.pageIndex;
+}
+
+void PagesSpool::clear()
+{
+    m_pages.clear();
+    m_spilledPages.clear();
+    m_file.reset();
+}
+
+void PagesSpool::collectContentItems(BaseDesignIntf *item, QList<ContentItemDesignIntf *> &items)
+{
+    foreach(BaseDesignIntf* child, item->childBaseItems()){
+        ContentItemDesignIntf* contentItem = dynamic_cast<ContentItemDesignIntf*>(child);
+        if (contentItem) items.append(contentItem);
+        collectContentItems(child, items);
+    }
+}
+
+QByteArray PagesSpool::saveContentBackups(PageItemDesignIntf *page)
+{
+    // The xml writer keeps properties only, so the content saved for the second
+    // pass is stored next to the page by the position of its item in the tree
+    QList<ContentItemDesignIntf*> items;
+    collectContentItems(page, items);
+    QByteArray result;
+    QDataStream stream(&result, QIODevice::WriteOnly);
+    for (int i = 0; i < items.size(); ++i){
+        if (items.at(i)->isContentBackedUp())
+            stream << qint32(i) << items.at(i)->objectName() << items.at(i)->contentBackUp();
+    }
+    return result;
+}
+
+bool PagesSpool::restoreContentBackups(PageItemDesignIntf *page, const QByteArray &backups)
+{
+    QList<ContentItemDesignIntf*> items;
+    collectContentItems(page, items);
+    QDataStream stream(backups);
+    while (!stream.atEnd()){
+        qint32 index;
+        QString name;
+        QString backup;
+        stream >> index >> name >> backup;
+        if (stream.status() != QDataStream::Ok || index < 0 || index >= items.size() || items.at(index)->objectName() != name)
+            return false;
+        items.at(index)->setContentBackUp(backup);
+    }
+    return true;
 }
 
 int PagesRanges::findLastPageNumber(int index)
@@ -30,10 +30,15 @@
 #ifndef LRREPORTRENDER_H
 #define LRREPORTRENDER_H
 #include <QObject>
+#include <QTemporaryFile>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QAtomicInt>
 #include "lrcollection.h"
 #include "lrdatasourcemanager.h"
 #include "lrpageitemdesignintf.h"
 #include "lrscriptenginemanager.h"
+#include "lrpagesinkintf.h"
 #include "serializators/lrstorageintf.h"
 
 namespace LimeReport{
@@ -58,6 +63,12 @@ private:
 };
 
 
+struct GroupFunctionsContent{
+    QString bandName;
+    QString source;
+    QString content;
+};
+
 struct PagesRange{
     int firstPage;
     int lastPage;
@@ -82,6 +93,88 @@ private:
     int m_TOCRangeIndex;
 };
 
+class BandRenderPlan{
+public:
+    typedef QSharedPointer<BandRenderPlan> Ptr;
+    explicit BandRenderPlan(BandDesignIntf* patternBand);
+    BandDesignIntf* patternBand() const {return m_patternBand;}
+    BandDesignIntf* instantiate(BaseDesignIntf::ItemMode mode, QObject* owner = 0, QGraphicsItem* parent = 0);
+    bool isPageDependent();
+private:
+    struct ItemPlan{
+        ItemPlan(): patternItem(0), contentProperty(-1), revision(-1), dependencyRevision(-1){}
+        BaseDesignIntf* patternItem;
+        QVector<int> children;
+        // pattern values which differ from the class defaults and whose
+        // changes are reported by the pattern item
+        BaseDesignIntf::PropertyValues properties;
+        // the content is read from the pattern for every row
+        int contentProperty;
+        // propertiesRevision() of the pattern item the values were taken at
+        int revision;
+        // values of the other properties the last instance was made with
+        BaseDesignIntf::PropertyValues unreported;
+        // propertiesRevision() of the pattern item the page dependency was checked at
+        int dependencyRevision;
+    };
+    int compile(BaseDesignIntf* item);
+    bool checkPageDependency() const;
+    BaseDesignIntf* instantiateItem(int index, BaseDesignIntf::ItemMode mode, QObject* owner, QGraphicsItem* parent);
+    static void removePropertyValue(BaseDesignIntf::PropertyValues& values, int propertyIndex);
+    static BaseDesignIntf::PropertyValues mergePropertyValues(const BaseDesignIntf::PropertyValues& values1,
+                                                              const BaseDesignIntf::PropertyValues& values2);
+private:
+    BandDesignIntf* m_patternBand;
+    QVector<ItemPlan> m_items;
+    bool m_pageDependent;
+    bool m_pageDependencyValid;
+};
+
+class PagesSpool{
+public:
+    PagesSpool(): m_maxPagesInMemory(16){}
+    int  maxPagesInMemory() const {return m_maxPagesInMemory;}
+    void setMaxPagesInMemory(int value){m_maxPagesInMemory = value;}
+    bool isEmpty() const {return m_pages.isEmpty() && m_spilledPages.isEmpty();}
+    void append(int pageIndex, PageItemDesignIntf::Ptr page);
+    int  takeFirst(PageItemDesignIntf::Ptr& page);
+    void clear();
+private:
+    struct SpilledPage{
+        int pageIndex;
+        qint64 offset;
+        qint64 size;
+        qint64 backupsSize;
+    };
+    static void collectContentItems(BaseDesignIntf* item, QList<ContentItemDesignIntf*>& items);
+    static QByteArray saveContentBackups(PageItemDesignIntf* page);
+    static bool restoreContentBackups(PageItemDesignIntf* page, const QByteArray& backups);
+    QList< QPair<int, PageItemDesignIntf::Ptr> > m_pages;
+    QList<SpilledPage> m_spilledPages;
+    QScopedPointer<QTemporaryFile> m_file;
+    int m_maxPagesInMemory;
+};
+
+
+class EventsProcessor{
+public:
+    EventsProcessor(): m_renderMode(InteractiveRenderMode), m_interval(0){}
+    RenderMode renderMode() const {return m_renderMode;}
+    void setRenderMode(RenderMode value){m_renderMode = value;}
+    int interval() const {return m_interval;}
+    void setInterval(int msec){m_interval = msec;}
+    void start(){m_timer.start();}
+    void processEvents(){
+        if (m_renderMode == HeadlessRenderMode) return;
+        if (m_interval > 0 && m_timer.isValid() && m_timer.elapsed() < m_interval) return;
+        QCoreApplication::processEvents();
+        m_timer.start();
+    }
+private:
+    RenderMode m_renderMode;
+    int m_interval;
+    QElapsedTimer m_timer;
+};
 
 class ReportRender: public QObject
 {
@@ -105,6 +198,15 @@ public:
     ReportPages renderTOC(PageItemDesignIntf *patternPage, bool first, bool resetPages);
     void    secondRenderPass(ReportPages renderedPages);
     void    createTOCMarker(bool startNewRange);
+    IPageSink* pageSink(){return m_pageSink;}
+    void    setPageSink(IPageSink* pageSink);
+    void    setMaxSpooledPagesInMemory(int value){m_pagesSpool.setMaxPagesInMemory(value);}
+    void    finishPageStream();
+    RenderMode renderMode() const {return m_eventsProcessor.renderMode();}
+    void    setRenderMode(RenderMode value){m_eventsProcessor.setRenderMode(value);}
+    void    setEventsProcessingInterval(int msec){m_eventsProcessor.setInterval(msec);}
+    bool    isRenderCanceled() const {return m_renderCanceled->loadAcquire() != 0;}
+    void    setRenderCanceledFlag(QAtomicInt* flag){m_renderCanceled = flag ? flag : &m_ownRenderCanceled;}
 signals:
     void    pageRendered(int renderedPageCount);
 public slots:
@@ -143,14 +245,15 @@ private:
     void	extractGroupFuntionsFromItem(ContentItemDesignIntf* contentItem, BandDesignIntf* band);
     void    extractGroupFunctionsFromContainer(BaseDesignIntf* baseItem, BandDesignIntf* band);
     void    extractGroupFunctions(BandDesignIntf* band);
+    QString replaceGroupFunctions(QString content, const QVector<QString>& functions, const QString& bandName);
     void    replaceGroupFunctionsInItem(ContentItemDesignIntf* contentItem, BandDesignIntf* band);
     void    replaceGroupFunctionsInContainer(BaseDesignIntf* baseItem, BandDesignIntf* band);
     void    replaceGroupsFunction(BandDesignIntf* band);
 
     BandDesignIntf *findRecalcableBand(BandDesignIntf *patternBand);
 
-    void    popPageFooterGroupValues(BandDesignIntf* dataBand);
-    void    pushPageFooterGroupValues(BandDesignIntf* dataBand);
+    void    popPageFooterGroupValues(BandDesignIntf* band);
+    void    pushPageFooterGroupValues(BandDesignIntf* band);
 
     enum    GroupType{DATA,FOOTER};
     void    closeGroup(BandDesignIntf* band);
@@ -158,13 +261,16 @@ private:
     void    closeDataGroup(BandDesignIntf* band);
     void    openFooterGroup(BandDesignIntf* band);
     void    closeFooterGroup(BandDesignIntf* band);
-    void    cutGroups();
     void    checkFooterGroup(BandDesignIntf* groupBand);
     void    pasteGroups();
     void    checkLostHeadersOnPrevPage();
     void    checkLostHeadersInPrevColumn();
 
-    BandDesignIntf* findEnclosingGroup();
+    bool    isInKeptTogetherGroup(BandDesignIntf* band);
+    bool    hasKeptTogetherGroup();
+    bool    canBeGrouped(BandDesignIntf* band);
+    void    attachBand(BandDesignIntf* band);
+    void    attachPendingBands(bool all = false);
     bool    registerBand(BandDesignIntf* band, bool registerInChildren=true);
     BandDesignIntf *sliceBand(BandDesignIntf* band, BandDesignIntf *patternBand, bool isLast);
 
@@ -174,6 +280,11 @@ private:
     void    startNewPage(bool isFirst = false);
     void    resetPageNumber(ResetPageNuberType resetType);
     void    savePage(bool isLast = false);
+    bool    isNeedSecondPass(PageItemDesignIntf* page);
+    void    renderSecondPass(PageItemDesignIntf* page, int pageIndex);
+    BandRenderPlan::Ptr bandRenderPlan(BandDesignIntf* patternBand);
+    void    streamRenderedPages();
+    void    flushPagesSpool();
     QString toString();
     void initColumns();
     bool isNeedToRearrangeColumnsItems();
@@ -185,7 +296,7 @@ private:
     void renameChildItems(BaseDesignIntf *item);
     void renderGroupFooterByHeader(BandDesignIntf *groupHeader);
     void updateTOC(BaseDesignIntf* item, int pageNumber);
-    void placeBandOnPage(BandDesignIntf *band, int columnIndex);
+    void placeBandOnPage(BandDesignIntf *band, int columnIndex, bool attach = true);
     QColor makeBackgroundColor(BandDesignIntf *band);
 private:
     DataSourceManager* m_datasources;
@@ -194,14 +305,16 @@ private:
     PageItemDesignIntf* m_patternPageItem;
     QList<PageItemDesignIntf::Ptr> m_renderedPages;
     QMultiMap< BandDesignIntf*, GroupBandsHolder* > m_childBands;
+    // placed bands which are added to the page once their groups fit on it
+    QList<BandDesignIntf*> m_pendingBands;
     QList<BandDesignIntf*> m_reprintableBands;
     QList<BandDesignIntf*> m_recalcBands;
     QMap<QString, QVector<QString> > m_groupfunctionItems;
+    QMap<QString, GroupFunctionsContent> m_groupFunctionsContent;
     int m_currentIndex;
     int m_pageCount;
 
-    QMap<QString,QVariant> m_popupedValues;
-    QMultiMap<BandDesignIntf*,QString> m_popupedExpression;
+    QHash<QPair<BandDesignIntf*, GroupFunction*>, QVariant> m_popupedValues;
 
     qreal           m_pageFooterHeight;
     qreal           m_dataAreaSize;
@@ -211,7 +324,9 @@ private:
     BandDesignIntf* m_lastDataBand;
     BandDesignIntf* m_lastRenderedFooter;
     BandDesignIntf* m_lastRenderedBand;
-    bool            m_renderCanceled;
+    QAtomicInt      m_ownRenderCanceled;
+    QAtomicInt*     m_renderCanceled;
+    EventsProcessor m_eventsProcessor;
     QVector<qreal>  m_maxHeightByColumn;
     QVector<qreal>  m_currentStartDataPos;
     int             m_currentColumn;
@@ -220,6 +335,10 @@ private:
     unsigned long long m_currentNameIndex;
     bool            m_newPageStarted;
     bool            m_lostHeadersMoved;
+    IPageSink*      m_pageSink;
+    PagesSpool      m_pagesSpool;
+    int             m_streamedPagesCount;
+    QHash<BandDesignIntf*, BandRenderPlan::Ptr> m_bandRenderPlans;
 
 };
 } // namespace LimeReport
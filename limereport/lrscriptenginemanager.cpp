@@ -31,6 +31,7 @@
 
 #include <QDate>
 #include <QStringList>
+#include <QSet>
 #include <QUuid>
 #ifdef USE_QTSCRIPTENGINE
 #include <QScriptValueIterator>
@@ -458,16 +459,17 @@ QString ScriptEngineManager::expandDataFields(QString context, ExpandType expand
     if (context.contains(rx)){
         while ((rx.indexIn(context))!=-1){
             QString field=rx.cap(1);
+            FieldHandle handle = dataManager()->fieldHandle(field);
 
-            if (dataManager()->containsField(field)) {
+            if (handle.isValid()) {
                 QString fieldValue;
-                varValue = dataManager()->fieldData(field);
+                varValue = dataManager()->fieldData(handle);
                 if (expandType == EscapeSymbols) {
                     if (varValue.isNull()) {
                         fieldValue="\"\"";
                     } else {
                         fieldValue = escapeSimbols(varValue.toString());
-                        switch (dataManager()->fieldData(field).type()) {
+                        switch (varValue.type()) {
                         case QVariant::Char:
                         case QVariant::String:
                         case QVariant::StringList:
@@ -510,62 +512,7 @@ QString ScriptEngineManager::expandDataFields(QString context, ExpandType expand
         while (match.hasMatch()){
 
             QString field=match.captured(1);
-
-            if (dataManager()->containsField(field)) {
-                QString fieldValue;
-                varValue = dataManager()->fieldData(field);
-                if (expandType == EscapeSymbols) {
-                    if (varValue.isNull()) {
-                        fieldValue="\"\"";
-                    } else {
-                        fieldValue = escapeSimbols(varValue.toString());
-                        //TODO: Migrate to QMetaType
-#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
-                        switch (dataManager()->fieldData(field).typeId()) {
-                            case QMetaType::QChar:
-                            case QMetaType::QString:
-                            case QMetaType::QStringList:
-                            case QMetaType::QDate:
-                            case QMetaType::QDateTime:
-                                fieldValue = "\""+fieldValue+"\"";
-                                break;
-                            default:
-                                break;
-                        }
-#else
-                        switch (dataManager()->fieldData(field).type()) {
-                            case QVariant::Char:
-                            case QVariant::String:
-                            case QVariant::StringList:
-                            case QVariant::Date:
-                            case QVariant::DateTime:
-                                fieldValue = "\""+fieldValue+"\"";
-                                break;
-                            default:
-                                break;
-                        }
-#endif
-                    }
-                } else {
-                    if (expandType == ReplaceHTMLSymbols)
-                        fieldValue = replaceHTMLSymbols(varValue.toString());
-                    else fieldValue = varValue.toString();
-                }
-
-                context.replace(match.captured(0),fieldValue);
-
-            } else {
-                QString error;
-                if (reportItem){
-                    error = tr("Field %1 not found in %2!").arg(field).arg(reportItem->objectName());
-                    dataManager()->putError(error);
-                }
-                varValue = QVariant();
-                if (!dataManager()->reportSettings() || !dataManager()->reportSettings()->suppressAbsentFieldsAndVarsWarnings())
-                    context.replace(match.captured(0), error);
-                else
-                    context.replace(match.captured(0), "");
-            }
+            context.replace(match.captured(0), fieldValue(field, expandType, varValue, reportItem));
             match = rx.match(context);
         }
     }
@@ -585,34 +532,273 @@ QString ScriptEngineManager::expandScripts(QString context, QVariant& varValue,
     if(context.contains(rx)){
 #endif
 
-        if (ScriptEngineManager::instance().dataManager() != dataManager())
-            ScriptEngineManager::instance().setDataManager(dataManager());
+        ScriptEngineType* se = prepareScriptEngine(reportItem);
 
-        ScriptEngineType* se = ScriptEngineManager::instance().scriptEngine();
+        ScriptExtractor scriptExtractor(context);
+        if (scriptExtractor.parse()){
+            context = replaceScripts(context, varValue, reportItem, se, scriptExtractor.scriptTree());
+        }
 
-        if (reportItem){
-            ScriptValueType svThis;
+    }
+    return context;
+}
+
+ScriptEngineType* ScriptEngineManager::prepareScriptEngine(QObject *reportItem)
+{
+    ScriptEngineType* se = scriptEngine();
+
+    if (reportItem){
+        ScriptValueType svThis;
 #ifdef USE_QJSENGINE
-            svThis = getJSValue(*se, reportItem);
-            se->globalObject().setProperty("THIS",svThis);
+        svThis = getJSValue(*se, reportItem);
+        se->globalObject().setProperty("THIS",svThis);
 #else
-            svThis = se->globalObject().property("THIS");
-            if (svThis.isValid()){
-                se->newQObject(svThis, reportItem);
+        svThis = se->globalObject().property("THIS");
+        if (svThis.isValid()){
+            se->newQObject(svThis, reportItem);
+        } else {
+            svThis = se->newQObject(reportItem);
+            se->globalObject().setProperty("THIS",svThis);
+        }
+#endif
+    }
+    return se;
+}
+
+QString ScriptEngineManager::expandParts(QString context, int parts, ExpandType expandType, QVariant &varValue, QObject *reportItem)
+{
+    if (parts & ExpandVariables)
+        context = expandUserVariables(context, FirstPass, expandType, varValue);
+    if (parts & ExpandScripts)
+        context = expandScripts(context, varValue, reportItem);
+    if (parts & ExpandDataFields)
+        context = expandDataFields(context, expandType, varValue, reportItem);
+    return context;
+}
+
+QString ScriptEngineManager::variableValue(const QVariant &value, ExpandType expandType)
+{
+    switch (expandType){
+    case EscapeSymbols:
+        return escapeSimbols(value.toString());
+    case ReplaceHTMLSymbols:
+        return replaceHTMLSymbols(value.toString());
+    default:
+        return value.toString();
+    }
+}
+
+QString ScriptEngineManager::fieldValue(const QString &field, ExpandType expandType, QVariant &varValue, QObject *reportItem)
+{
+    FieldHandle handle = dataManager()->fieldHandle(field);
+    if (handle.isValid()) {
+        QString fieldValue;
+        varValue = dataManager()->fieldData(handle);
+        if (expandType == EscapeSymbols) {
+            if (varValue.isNull()) {
+                fieldValue="\"\"";
             } else {
-                svThis = se->newQObject(reportItem);
-                se->globalObject().setProperty("THIS",svThis);
+                fieldValue = escapeSimbols(varValue.toString());
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+                switch (varValue.typeId()) {
+                    case QMetaType::QChar:
+                    case QMetaType::QString:
+                    case QMetaType::QStringList:
+                    case QMetaType::QDate:
+                    case QMetaType::QDateTime:
+                        fieldValue = "\""+fieldValue+"\"";
+                        break;
+                    default:
+                        break;
+                }
+#else
+                switch (varValue.type()) {
+                    case QVariant::Char:
+                    case QVariant::String:
+                    case QVariant::StringList:
+                    case QVariant::Date:
+                    case QVariant::DateTime:
+                        fieldValue = "\""+fieldValue+"\"";
+                        break;
+                    default:
+                        break;
+                }
+#endif
             }
+        } else {
+            if (expandType == ReplaceHTMLSymbols)
+                fieldValue = replaceHTMLSymbols(varValue.toString());
+            else fieldValue = varValue.toString();
+        }
+        return fieldValue;
+    } else {
+        QString error;
+        if (reportItem){
+            error = tr("Field %1 not found in %2!").arg(field).arg(reportItem->objectName());
+            dataManager()->putError(error);
+        }
+        varValue = QVariant();
+        if (!dataManager()->reportSettings() || !dataManager()->reportSettings()->suppressAbsentFieldsAndVarsWarnings())
+            return error;
+        else
+            return "";
+    }
+}
+
+QString ScriptEngineManager::evaluateTemplateScript(ScriptEngineType *se, const QString &scriptBody, QVariant &varValue)
+{
+    ScriptValueType value = se->evaluate(scriptBody);
+#ifdef USE_QJSENGINE
+    if (!value.isError())
+        varValue = value.toVariant();
+    return value.toString();
+#else
+    if (!se->hasUncaughtException()) {
+        varValue = value.toVariant();
+        return value.toString();
+    }
+    return se->uncaughtException().toString();
 #endif
+}
+
+ContentTemplate::Ptr ScriptEngineManager::contentTemplate(const QString &content)
+{
+    ContentTemplate::Ptr result = m_contentTemplates.value(content);
+    if (result.isNull()){
+        if (m_contentTemplates.size() >= Const::MAX_CONTENT_TEMPLATES)
+            m_contentTemplates.clear();
+        result = ContentTemplate::compile(content);
+        m_contentTemplates.insert(content, result);
+    }
+    return result;
+}
+
+QString ScriptEngineManager::expandTemplate(const QString &context, int parts, ExpandType expandType, QVariant &varValue, QObject *reportItem)
+{
+    // Gives the same result as expandUserVariables(), expandScripts() and expandDataFields()
+    // called one after another, but the content is parsed only once. Whenever a value
+    // could bring new markers into the text the regular expansion is used instead.
+    ContentTemplate::Ptr contentTemplate = this->contentTemplate(context);
+    if (!contentTemplate->isValid())
+        return expandParts(context, parts, expandType, varValue, reportItem);
+    if (contentTemplate->isLiteral())
+        return context;
+
+    bool scriptsExpanded = (parts & ExpandScripts) && contentTemplate->hasScripts();
+    bool variablesExpanded = (parts & ExpandVariables) && !contentTemplate->variables().isEmpty();
+    bool fieldsExpanded = parts & ExpandDataFields;
+
+    QHash<QString, QString> variables;
+    if (variablesExpanded){
+        foreach(const ContentTemplate::Segment& variable, contentTemplate->variables()){
+            if (!dataManager()->containsVariable(variable.name))
+                return expandParts(context, parts, expandType, varValue, reportItem);
+            QVariant value;
+            try {
+                value = dataManager()->variable(variable.name);
+            } catch (ReportError &){
+                return expandParts(context, parts, expandType, varValue, reportItem);
+            }
+            QString valueStr = variableValue(value, expandType);
+            if (valueStr.contains('$') || valueStr.contains('{') || valueStr.contains('}') ||
+                (scriptsExpanded && valueStr.contains('\n'))
+            )
+                return expandParts(context, parts, expandType, varValue, reportItem);
+            variables.insert(variable.text, valueStr);
+            varValue = value;
         }
+    }
 
-        ScriptExtractor scriptExtractor(context);
-        if (scriptExtractor.parse()){
-            context = replaceScripts(context, varValue, reportItem, se, scriptExtractor.scriptTree());
+    const QVector<ContentTemplate::Segment>& segments = scriptsExpanded ? contentTemplate->segments() : contentTemplate->flatSegments();
+    QVector<QString> scriptResults;
+    bool rescanFields = false;
+
+    if (scriptsExpanded){
+        ScriptEngineType* se = prepareScriptEngine(reportItem);
+        QHash<QString, QString> evaluatedScripts;
+        foreach(const ContentTemplate::Segment& segment, segments){
+            if (segment.type != ContentTemplate::ScriptSegment) continue;
+            QString rawBody;
+            QString scriptBody;
+            QHash<QString, QString> bodyFields;
+            bool rescanBody = false;
+            foreach(const ContentTemplate::Segment& item, contentTemplate->scriptBody(segment.bodyIndex)){
+                switch (item.type) {
+                case ContentTemplate::VariableSegment:
+                    if (variablesExpanded){
+                        rawBody += variables.value(item.text);
+                        scriptBody += variables.value(item.text);
+                    } else {
+                        rawBody += item.text;
+                        scriptBody += item.text;
+                        rescanBody = true;
+                    }
+                    break;
+                case ContentTemplate::FieldSegment:
+                    rawBody += item.text;
+                    if (!bodyFields.contains(item.text)){
+                        QString value = fieldValue(item.name, EscapeSymbols, varValue, reportItem);
+                        if (value.contains('$')) rescanBody = true;
+                        bodyFields.insert(item.text, value);
+                    }
+                    scriptBody += bodyFields.value(item.text);
+                    break;
+                default:
+                    rawBody += item.text;
+                    scriptBody += item.text;
+                    break;
+                }
+            }
+            if (rescanBody){
+                scriptBody = expandDataFields(rawBody, EscapeSymbols, varValue, reportItem);
+                scriptBody = expandUserVariables(scriptBody, FirstPass, EscapeSymbols, varValue);
+            }
+            QString result = evaluateTemplateScript(se, scriptBody, varValue);
+            QString script = segment.name + rawBody + '}';
+            if (evaluatedScripts.contains(script))
+                result = evaluatedScripts.value(script);
+            else
+                evaluatedScripts.insert(script, result);
+            if (result.contains('$')) rescanFields = true;
+            scriptResults.append(result);
         }
+    }
 
+    QHash<QString, QString> fields;
+    if (fieldsExpanded && !rescanFields){
+        foreach(const ContentTemplate::Segment& segment, segments){
+            if (segment.type == ContentTemplate::FieldSegment && !fields.contains(segment.text)){
+                QString value = fieldValue(segment.name, expandType, varValue, reportItem);
+                if (value.contains('$')) rescanFields = true;
+                fields.insert(segment.text, value);
+            }
+        }
     }
-    return context;
+
+    QString result;
+    result.reserve(context.size() * 2);
+    int scriptIndex = 0;
+    foreach(const ContentTemplate::Segment& segment, segments){
+        switch (segment.type) {
+        case ContentTemplate::VariableSegment:
+            result += variablesExpanded ? variables.value(segment.text) : segment.text;
+            break;
+        case ContentTemplate::FieldSegment:
+            result += (fieldsExpanded && !rescanFields) ? fields.value(segment.text) : segment.text;
+            break;
+        case ContentTemplate::ScriptSegment:
+            result += scriptResults.at(scriptIndex++);
+            break;
+        default:
+            result += segment.text;
+            break;
+        }
+    }
+
+    if (fieldsExpanded && rescanFields)
+        result = expandDataFields(result, expandType, varValue, reportItem);
+
+    return result;
 }
 
 QString ScriptEngineManager::replaceScripts(QString context, QVariant &varValue, QObject *reportItem, ScriptEngineType* se, ScriptNode::Ptr scriptTree)
@@ -656,10 +842,7 @@ QVariant ScriptEngineManager::evaluateScript(const QString& script){
     if (script.contains(rx)){
 #endif
 
-        if (ScriptEngineManager::instance().dataManager()!=dataManager())
-            ScriptEngineManager::instance().setDataManager(dataManager());
-
-        ScriptEngineType* se = ScriptEngineManager::instance().scriptEngine();
+        ScriptEngineType* se = scriptEngine();
 
         ScriptExtractor scriptExtractor(script);
         if (scriptExtractor.parse()){
@@ -1146,6 +1329,17 @@ bool ScriptEngineManager::createColumnCount()
     return addFunction(fd);
 }
 
+ScriptEngineManager& ScriptEngineManager::forDataManager(DataSourceManager *dataManager)
+{
+    // Every report engine owns its script engine manager, the shared instance
+    // is left for data managers that don't belong to a report engine.
+    if (dataManager && dataManager->scriptManager())
+        return *dataManager->scriptManager();
+    ScriptEngineManager& sm = ScriptEngineManager::instance();
+    if (dataManager && sm.dataManager() != dataManager) sm.setDataManager(dataManager);
+    return sm;
+}
+
 ScriptEngineManager::ScriptEngineManager()
     :m_model(0), m_context(0), m_dataManager(0)
 {
@@ -1304,6 +1498,161 @@ QString ScriptExtractor::substring(const QString &value, int start, int end)
     return value.mid(start,end-start);
 }
 
+ContentTemplate::Ptr ContentTemplate::compile(const QString &content)
+{
+    ContentTemplate::Ptr result(new ContentTemplate());
+
+    if (!result->parseText(content, result->m_flatSegments)){
+        result->m_valid = false;
+        return result;
+    }
+
+    QVector<ScriptNode::Ptr> scripts;
+#if (QT_VERSION < QT_VERSION_CHECK(5, 15, 1))
+    QRegExp rx(Const::SCRIPT_RX);
+#else
+    QRegularExpression rx = getScriptRegEx();
+#endif
+    if (content.contains(rx)){
+        ScriptExtractor scriptExtractor(content);
+        if (scriptExtractor.parse())
+            scripts = scriptExtractor.scriptTree()->children();
+    }
+
+    if (scripts.isEmpty()){
+        result->m_segments = result->m_flatSegments;
+    } else {
+        int pos = 0;
+        foreach(ScriptNode::Ptr scriptNode, scripts){
+            QString script = scriptNode->script();
+            int start = content.indexOf(script, pos);
+            if (start == -1 || script.length() < 3 || !scriptNode->children().isEmpty()){
+                // nested or unfinished scripts are left to the regular expansion
+                result->m_valid = false;
+                return result;
+            }
+            if (!result->parseText(content.mid(pos, start - pos), result->m_segments)){
+                result->m_valid = false;
+                return result;
+            }
+            QString startLex = script.left(script.length() - scriptNode->body().length() - 1);
+            QVector<Segment> body;
+            if (!result->parseText(scriptNode->body(), body)){
+                result->m_valid = false;
+                return result;
+            }
+            Segment segment;
+            segment.type = ScriptSegment;
+            segment.text = script;
+            segment.name = startLex;
+            segment.bodyIndex = result->m_scriptBodies.size();
+            result->m_scriptBodies.append(body);
+            result->m_segments.append(segment);
+            result->m_literal = false;
+            pos = start + script.length();
+        }
+        if (!result->parseText(content.mid(pos), result->m_segments)){
+            result->m_valid = false;
+            return result;
+        }
+    }
+
+    QSet<QString> variableMarkers;
+    foreach(const Segment& segment, result->m_flatSegments){
+        if (segment.type == VariableSegment && !variableMarkers.contains(segment.text)){
+            variableMarkers.insert(segment.text);
+            result->m_variables.append(segment);
+        }
+    }
+
+    return result;
+}
+
+bool ContentTemplate::parseText(const QString &text, QVector<Segment> &segments)
+{
+    int pos = 0;
+    // the match of the regular expression which was not taken is kept until pos passes it,
+    // -1 means there are no more matches
+    int fieldPos = -2;
+    int variablePos = -2;
+#if (QT_VERSION < QT_VERSION_CHECK(5, 15, 1))
+    QRegExp fieldRx(Const::FIELD_RX);
+    QRegExp variableRx(Const::VARIABLE_RX);
+#else
+    QRegularExpressionMatch fieldMatch;
+    QRegularExpressionMatch variableMatch;
+#endif
+    while (pos < text.length()){
+        Segment segment;
+        int start = -1;
+        int length = 0;
+#if (QT_VERSION < QT_VERSION_CHECK(5, 15, 1))
+        if (fieldPos != -1 && fieldPos < pos)
+            fieldPos = fieldRx.indexIn(text, pos);
+        if (variablePos != -1 && variablePos < pos)
+            variablePos = variableRx.indexIn(text, pos);
+        if (fieldPos != -1 && (variablePos == -1 || fieldPos < variablePos)){
+            start = fieldPos;
+            length = fieldRx.matchedLength();
+            segment.type = FieldSegment;
+            segment.name = fieldRx.cap(1);
+        } else if (variablePos != -1){
+            start = variablePos;
+            length = variableRx.matchedLength();
+            segment.type = VariableSegment;
+            segment.name = variableRx.cap(1);
+        }
+#else
+        if (fieldPos != -1 && fieldPos < pos){
+            fieldMatch = getFieldRegEx().match(text, pos);
+            fieldPos = fieldMatch.hasMatch() ? fieldMatch.capturedStart() : -1;
+        }
+        if (variablePos != -1 && variablePos < pos){
+            variableMatch = getVariableRegEx().match(text, pos);
+            variablePos = variableMatch.hasMatch() ? variableMatch.capturedStart() : -1;
+        }
+        if (fieldPos != -1 && (variablePos == -1 || fieldPos < variablePos)){
+            start = fieldPos;
+            length = fieldMatch.capturedLength();
+            segment.type = FieldSegment;
+            segment.name = fieldMatch.captured(1);
+        } else if (variablePos != -1){
+            start = variablePos;
+            length = variableMatch.capturedLength();
+            segment.type = VariableSegment;
+            segment.name = variableMatch.captured(1);
+        }
+#endif
+        if (start == -1) break;
+
+        // A value placed right after '$' could form a new marker together with the text around it.
+        int prior = start - 1;
+        while (prior >= 0 && text.at(prior).isSpace())
+            --prior;
+        if (prior >= 0 && text.at(prior) == '$')
+            return false;
+
+        appendLiteral(text.mid(pos, start - pos), segments);
+        segment.text = text.mid(start, length);
+        segment.bodyIndex = -1;
+        segments.append(segment);
+        m_literal = false;
+        pos = start + length;
+    }
+    appendLiteral(text.mid(pos), segments);
+    return true;
+}
+
+void ContentTemplate::appendLiteral(const QString &text, QVector<Segment> &segments)
+{
+    if (text.isEmpty()) return;
+    Segment segment;
+    segment.type = LiteralSegment;
+    segment.text = text;
+    segment.bodyIndex = -1;
+    segments.append(segment);
+}
+
 QString DialogDescriber::name() const
 {
     return m_name;
@@ -1486,6 +1835,11 @@ void ScriptEngineContext::setReportPages(ReportPages *value)
     m_reportPages = value;
 }
 
+ScriptEngineManager* ScriptEngineContext::scriptManager() const
+{
+    return m_scriptManager ? m_scriptManager : &ScriptEngineManager::instance();
+}
+
 #ifdef HAVE_UI_LOADER
 QDialog* ScriptEngineContext::createDialog(DialogDescriber* cont)
 {
@@ -1595,7 +1949,7 @@ void ScriptEngineContext::baseDesignIntfToScript(const QString& pageName, BaseDe
         if (item->metaObject()->indexOfSignal("afterRender()")!=-1)
             item->disconnect(SIGNAL(afterRender()));
 
-        ScriptEngineType* engine = ScriptEngineManager::instance().scriptEngine();
+        ScriptEngineType* engine = scriptManager()->scriptEngine();
 
 #ifdef USE_QJSENGINE
         ScriptValueType sItem = getJSValue(*engine, item);
@@ -1619,7 +1973,7 @@ void ScriptEngineContext::baseDesignIntfToScript(const QString& pageName, BaseDe
 
 void ScriptEngineContext::qobjectToScript(const QString& name, QObject *item)
 {
-    ScriptEngineType* engine = ScriptEngineManager::instance().scriptEngine();
+    ScriptEngineType* engine = scriptManager()->scriptEngine();
 #ifdef USE_QJSENGINE
     ScriptValueType sItem = getJSValue(*engine, item);
     engine->globalObject().setProperty(name, sItem);
@@ -1649,7 +2003,7 @@ void registerChildObjects(ScriptEngineType* se, ScriptValueType* root, QObject*
 #endif
 
 void ScriptEngineContext::initDialogs(){
-    ScriptEngineType* se = ScriptEngineManager::instance().scriptEngine();
+    ScriptEngineType* se = scriptManager()->scriptEngine();
     foreach(DialogDescriber::Ptr dialog, dialogDescribers()){
         ScriptValueType sv = se->newQObject(getDialog(dialog->name()));
 #ifdef USE_QJSENGINE
@@ -1664,8 +2018,8 @@ void ScriptEngineContext::initDialogs(){
 
 bool ScriptEngineContext::runInitScript(){
 
-    ScriptEngineType* engine = ScriptEngineManager::instance().scriptEngine();
-    ScriptEngineManager::instance().setContext(this);
+    ScriptEngineType* engine = scriptManager()->scriptEngine();
+    scriptManager()->setContext(this);
     m_tableOfContents->clear();
 
     ScriptValueType res = engine->evaluate(initScript());
@@ -179,7 +179,7 @@ public:
 #endif
     explicit ScriptEngineContext(QObject* parent=0):
         QObject(parent), m_currentBand(0), m_currentPage(0),
-        m_tableOfContents(new TableOfContents(this)), m_hasChanges(false) {}
+        m_tableOfContents(new TableOfContents(this)), m_hasChanges(false), m_scriptManager(0) {}
 #ifdef HAVE_UI_LOADER
     void    addDialog(const QString& name, const QByteArray& description);
     bool    changeDialog(const QString& name, const QByteArray &description);
@@ -209,6 +209,8 @@ public:
     bool hasChanges(){ return m_hasChanges;}
     ReportPages* reportPages() const;
     void setReportPages(ReportPages* value);
+    ScriptEngineManager* scriptManager() const;
+    void setScriptManager(ScriptEngineManager* value){m_scriptManager = value;}
 #ifdef HAVE_UI_LOADER
 signals:
     void    dialogNameChanged(QString dialogName);
@@ -237,6 +239,7 @@ private:
     TableOfContents* m_tableOfContents;
     bool m_hasChanges;
     ReportPages* m_reportPages;
+    ScriptEngineManager* m_scriptManager;
 };
 
 class JSFunctionDesc{
@@ -482,13 +485,47 @@ private:
     ScriptNode::Ptr m_scriptTree;
 };
 
+class ContentTemplate
+{
+public:
+    typedef QSharedPointer<ContentTemplate> Ptr;
+    enum SegmentType{LiteralSegment, FieldSegment, VariableSegment, ScriptSegment};
+    struct Segment{
+        SegmentType type;
+        QString text;
+        QString name;
+        int bodyIndex;
+    };
+    static Ptr compile(const QString& content);
+    bool isValid() const {return m_valid;}
+    bool isLiteral() const {return m_literal;}
+    bool hasScripts() const {return !m_scriptBodies.isEmpty();}
+    const QVector<Segment>& segments() const {return m_segments;}
+    const QVector<Segment>& flatSegments() const {return m_flatSegments;}
+    const QVector<Segment>& scriptBody(int index) const {return m_scriptBodies.at(index);}
+    const QVector<Segment>& variables() const {return m_variables;}
+private:
+    ContentTemplate(): m_valid(true), m_literal(true){}
+    bool parseText(const QString& text, QVector<Segment>& segments);
+    void appendLiteral(const QString& text, QVector<Segment>& segments);
+private:
+    QVector<Segment> m_segments;
+    QVector<Segment> m_flatSegments;
+    QVector< QVector<Segment> > m_scriptBodies;
+    QVector<Segment> m_variables;
+    bool m_valid;
+    bool m_literal;
+};
+
 class ScriptEngineManager : public QObject, public Singleton<ScriptEngineManager>, public IScriptEngineManager
 {
     Q_OBJECT
 public:
     friend class Singleton<ScriptEngineManager>;
-    ScriptEngineType* scriptEngine(){return m_scriptEngine;}
+    ScriptEngineManager();
     ~ScriptEngineManager();
+    static ScriptEngineManager& forDataManager(DataSourceManager* dataManager);
+    ScriptEngineType* scriptEngine(){return m_scriptEngine;}
     bool isFunctionExists(const QString& functionName) const;
     void deleteFunction(const QString& functionsName);
 
@@ -509,6 +546,8 @@ public:
     QString expandUserVariables(QString context, RenderPass pass, ExpandType expandType, QVariant &varValue);
     QString expandDataFields(QString context, ExpandType expandType, QVariant &varValue, QObject* reportItem);
     QString expandScripts(QString context, QVariant &varValue, QObject* reportItem);
+    QString expandTemplate(const QString& context, int parts, ExpandType expandType, QVariant &varValue, QObject* reportItem);
+    ContentTemplate::Ptr contentTemplate(const QString& content);
 
     QString replaceScripts(QString context, QVariant& varValue, QObject *reportItem, ScriptEngineType *se, ScriptNode::Ptr scriptTree);
 
@@ -523,6 +562,11 @@ protected:
     void updateModel();
 private:
     Q_DISABLE_COPY(ScriptEngineManager)
+    ScriptEngineType* prepareScriptEngine(QObject* reportItem);
+    QString expandParts(QString context, int parts, ExpandType expandType, QVariant &varValue, QObject* reportItem);
+    QString variableValue(const QVariant& value, ExpandType expandType);
+    QString fieldValue(const QString& field, ExpandType expandType, QVariant &varValue, QObject* reportItem);
+    QString evaluateTemplateScript(ScriptEngineType* se, const QString& scriptBody, QVariant &varValue);
     bool createLineFunction();
     bool createNumberFomatFunction();
     bool createDateFormatFunction();
@@ -550,7 +594,6 @@ private:
     bool createColumnCount();
 
 private:
-    ScriptEngineManager();
     ScriptEngineType*  m_scriptEngine;
     QString m_lastError;
     QHash<QString,ScriptFunctionDesc> m_functions;
@@ -558,6 +601,7 @@ private:
     ScriptEngineContext* m_context;
     DataSourceManager* m_dataManager;
     ScriptFunctionsManager* m_functionManager;
+    QHash<QString, ContentTemplate::Ptr> m_contentTemplates;
 };
 
 
@@ -36,8 +36,7 @@ ScriptEditor::~ScriptEditor()
 
 void ScriptEditor::initEditor(DataSourceManager* dm)
 {
-    ScriptEngineManager& se = LimeReport::ScriptEngineManager::instance();
-    se.setDataManager(dm);
+    ScriptEngineManager& se = LimeReport::ScriptEngineManager::forDataManager(dm);
 
     initCompleter();
 
@@ -202,7 +201,7 @@ void ReportStructureCompleater::addAdditionalDatawords(CompleterModel* model, Da
     }
 
 #ifdef USE_QJSENGINE
-    ScriptEngineManager& se = LimeReport::ScriptEngineManager::instance();
+    ScriptEngineManager& se = LimeReport::ScriptEngineManager::forDataManager(dataManager);
     QJSValue globalObject = se.scriptEngine()->globalObject();
     QJSValueIterator it(globalObject);
     while (it.hasNext()){
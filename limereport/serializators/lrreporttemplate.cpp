@@ -0,0 +1,220 @@
+/***************************************************************************
+ *   This file is part of the Lime Report project                          *
+ *   Copyright (C) 2021 by Alexander Arin                                  *
+ *   arin_a@bk.ru                                                          *
+ *                                                                         *
+ **                   GNU General Public License Usage                    **
+ *                                                                         *
+ *   This library is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ **                  GNU Lesser General Public License                    **
+ *                                                                         *
+ *   This library is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation, either version 3 of the    *
+ *   License, or (at your option) any later version.                       *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library.                                      *
+ *   If not, see <http://www.gnu.org/licenses/>.                           *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ ****************************************************************************/
+#include "lrreporttemplate.h"
+#include "lrxmlreader.h"
+#include "lrbasedesignintf.h"
+#include "lrcollection.h"
+#include "lrreporttranslation.h"
+
+#include <QFileInfo>
+#include <QCryptographicHash>
+#include <QMutexLocker>
+
+namespace LimeReport{
+
+void ReportTemplate::readItem(QObject *item) const
+{
+    readItemFromNode(item, m_root);
+}
+
+void ReportTemplate::readItemFromNode(QObject *item, const ReportTemplateNode &node) const
+{
+    ObjectLoadingStateIntf* lf = dynamic_cast<ObjectLoadingStateIntf*>(item);
+    if(lf) lf->objectLoadStarted();
+    foreach(const ReportTemplateNode& child, node.children){
+        switch (child.type) {
+        case ReportTemplateNode::ObjectNode:{
+            QObject* childItem = qvariant_cast<QObject*>(item->property(child.propertyName));
+            if (childItem)
+                readItemFromNode(childItem, child);
+            break;
+        }
+        case ReportTemplateNode::CollectionNode:
+            readCollection(item, child);
+            break;
+        case ReportTemplateNode::TranslationNode:
+            readTranslation(item, child);
+            break;
+        default:
+            item->setProperty(child.propertyName, child.value);
+        }
+    }
+    if (lf) lf->objectLoadFinished();
+
+    BaseDesignIntf* baseObj = dynamic_cast<BaseDesignIntf*>(item);
+    if(baseObj) {
+        foreach(QGraphicsItem* childItem,baseObj->childItems()){
+            BaseDesignIntf* baseItem = dynamic_cast<BaseDesignIntf*>(childItem);
+            if (baseItem) baseItem->parentObjectLoadFinished();
+        }
+    }
+}
+
+void ReportTemplate::readCollection(QObject *item, const ReportTemplateNode &node) const
+{
+    ICollectionContainer* collection = dynamic_cast<ICollectionContainer*>(item);
+    if (collection){
+        foreach(const ReportTemplateNode& element, node.children){
+            QObject* obj = collection->createElement(node.name, element.className);
+            if (obj)
+                readItemFromNode(obj, element);
+        }
+        collection->collectionLoadFinished(node.name);
+    }
+}
+
+void ReportTemplate::readTranslation(QObject *item, const ReportTemplateNode &node) const
+{
+    ITranslationContainer* tranclationContainer = dynamic_cast<ITranslationContainer*>(item);
+    if (tranclationContainer){
+        Translations* translations = tranclationContainer->translations();
+        foreach(const ReportTemplateNode& languageNode, node.children){
+            QLocale::Language language = (QLocale::Language)(languageNode.value.toMap().value("Value").toInt());
+            ReportTranslation* curTranslation = new ReportTranslation(language);
+            foreach(const ReportTemplateNode& pageNode, languageNode.children){
+                PageTranslation* pageTranslation = curTranslation->createEmptyPageTranslation();
+                pageTranslation->pageName = pageNode.name;
+                foreach(const ReportTemplateNode& itemNode, pageNode.children){
+                    ItemTranslation* itemTranslation = new ItemTranslation();
+                    itemTranslation->itemName = itemNode.name;
+                    foreach(const ReportTemplateNode& propertyNode, itemNode.children){
+                        QVariantMap attributes = propertyNode.value.toMap();
+                        PropertyTranslation* propertyTranslation = new PropertyTranslation;
+                        propertyTranslation->propertyName = propertyNode.name;
+                        propertyTranslation->value = attributes.value("Value").toString();
+                        propertyTranslation->sourceValue = attributes.value("SourceValue").toString();
+                        propertyTranslation->checked = attributes.value("Checked").toString().compare("Y") == 0;
+                        itemTranslation->propertyesTranslation.append(propertyTranslation);
+                    }
+                    pageTranslation->itemsTranslation.insert(itemTranslation->itemName, itemTranslation);
+                }
+            }
+            translations->insert(curTranslation->language(),curTranslation);
+        }
+    }
+}
+
+QString TemplateReader::itemType()
+{
+    return m_current ? QString("Object") : QString();
+}
+
+QString TemplateReader::itemClassName()
+{
+    return m_current ? m_template->root().className : QString();
+}
+
+bool TemplateReader::readItem(QObject *item)
+{
+    if (m_current){
+        m_template->readItem(item);
+    } else {
+        m_error=QString("Object %1 not founded").arg(item->objectName());
+        return false;
+    }
+    return true;
+}
+
+ItemsReaderIntf::Ptr ReportTemplateCache::fileReader(const QString &fileName, const QString &passPhrase)
+{
+    QFileInfo fi(fileName);
+    QString key = "file:" + fi.absoluteFilePath();
+    ReportTemplate::Ptr reportTemplate = findTemplate(key, fi.lastModified(), fi.size(), passPhrase);
+    if (!reportTemplate)
+        reportTemplate = parseTemplate(FileXMLReader::create(fileName), key, fi.lastModified(), fi.size(), passPhrase);
+    if (reportTemplate)
+        return TemplateReader::create(reportTemplate);
+    return FileXMLReader::create(fileName);
+}
+
+ItemsReaderIntf::Ptr ReportTemplateCache::byteArrayReader(QByteArray *data, const QString &passPhrase)
+{
+    if (!data) return ByteArrayXMLReader::create(data);
+    QString key = "data:" + QString::fromLatin1(QCryptographicHash::hash(*data, QCryptographicHash::Sha1).toHex());
+    ReportTemplate::Ptr reportTemplate = findTemplate(key, QDateTime(), data->size(), passPhrase);
+    if (!reportTemplate)
+        reportTemplate = parseTemplate(ByteArrayXMLReader::create(data), key, QDateTime(), data->size(), passPhrase);
+    if (reportTemplate)
+        return TemplateReader::create(reportTemplate);
+    return ByteArrayXMLReader::create(data);
+}
+
+ItemsReaderIntf::Ptr ReportTemplateCache::stringReader(const QString &data, const QString &passPhrase)
+{
+    QString key = "string:" + QString::fromLatin1(QCryptographicHash::hash(data.toUtf8(), QCryptographicHash::Sha1).toHex());
+    ReportTemplate::Ptr reportTemplate = findTemplate(key, QDateTime(), data.size(), passPhrase);
+    if (!reportTemplate)
+        reportTemplate = parseTemplate(StringXMLreader::create(data), key, QDateTime(), data.size(), passPhrase);
+    if (reportTemplate)
+        return TemplateReader::create(reportTemplate);
+    return StringXMLreader::create(data);
+}
+
+void ReportTemplateCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_templates.clear();
+}
+
+ReportTemplate::Ptr ReportTemplateCache::findTemplate(const QString &key, const QDateTime &lastModified, qint64 size, const QString &passPhrase)
+{
+    QMutexLocker locker(&m_mutex);
+    CacheEntry* entry = m_templates.object(key);
+    if (entry && entry->lastModified == lastModified &&
+        entry->size == size && entry->passPhrase == passPhrase
+    ){
+        return entry->reportTemplate;
+    }
+    return ReportTemplate::Ptr();
+}
+
+ReportTemplate::Ptr ReportTemplateCache::parseTemplate(ItemsReaderIntf::Ptr xmlReader, const QString &key,
+                                                      const QDateTime &lastModified, qint64 size, const QString &passPhrase)
+{
+    // the template is parsed outside of the lock, if two threads miss at once
+    // both of them parse it and the last one wins
+    xmlReader->setPassPhrase(passPhrase);
+    XMLReader* reader = dynamic_cast<XMLReader*>(xmlReader.data());
+    if (!reader || !xmlReader->first()) return ReportTemplate::Ptr();
+    ReportTemplate::Ptr reportTemplate = reader->readTemplate();
+    if (!reportTemplate) return reportTemplate;
+
+    CacheEntry* entry = new CacheEntry;
+    entry->lastModified = lastModified;
+    entry->size = size;
+    entry->passPhrase = passPhrase;
+    entry->reportTemplate = reportTemplate;
+
+    QMutexLocker locker(&m_mutex);
+    m_templates.insert(key, entry);
+    return reportTemplate;
+}
+
+}
@@ -0,0 +1,121 @@
+/***************************************************************************
+ *   This file is part of the Lime Report project                          *
+ *   Copyright (C) 2021 by Alexander Arin                                  *
+ *   arin_a@bk.ru                                                          *
+ *                                                                         *
+ **                   GNU General Public License Usage                    **
+ *                                                                         *
+ *   This library is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation, either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ **                  GNU Lesser General Public License                    **
+ *                                                                         *
+ *   This library is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation, either version 3 of the    *
+ *   License, or (at your option) any later version.                       *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library.                                      *
+ *   If not, see <http://www.gnu.org/licenses/>.                           *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ ****************************************************************************/
+#ifndef LRREPORTTEMPLATE_H
+#define LRREPORTTEMPLATE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QVariant>
+#include <QList>
+#include <QCache>
+#include <QDateTime>
+#include <QMutex>
+#include <QSharedPointer>
+
+#include "lrstorageintf.h"
+#include "base/lrsingleton.h"
+
+namespace LimeReport{
+
+// Parsed form of one xml node: property values are already deserialized,
+// so a template can be applied to new objects without touching xml
+struct ReportTemplateNode{
+    enum NodeType{PropertyNode, ObjectNode, CollectionNode, TranslationNode};
+    ReportTemplateNode(): type(PropertyNode){}
+    NodeType type;
+    QString name;
+    QByteArray propertyName;
+    QString className;
+    QVariant value;
+    QList<ReportTemplateNode> children;
+};
+
+class ReportTemplate{
+public:
+    typedef QSharedPointer<const ReportTemplate> Ptr;
+    ReportTemplate(const ReportTemplateNode& root): m_root(root){}
+    const ReportTemplateNode& root() const {return m_root;}
+    void readItem(QObject* item) const;
+private:
+    void readItemFromNode(QObject* item, const ReportTemplateNode& node) const;
+    void readCollection(QObject* item, const ReportTemplateNode& node) const;
+    void readTranslation(QObject* item, const ReportTemplateNode& node) const;
+private:
+    ReportTemplateNode m_root;
+};
+
+class TemplateReader : public ItemsReaderIntf{
+public:
+    static ItemsReaderIntf::Ptr create(ReportTemplate::Ptr reportTemplate){ return ItemsReaderIntf::Ptr(new TemplateReader(reportTemplate));}
+protected:
+//ItemsReaderIntf interface
+    bool first(){ m_current = true; return true;}
+    bool next(){ m_current = false; return false;}
+    bool prior(){ m_current = false; return false;}
+    QString itemType();
+    QString itemClassName();
+    bool readItem(QObject *item);
+    int firstLevelItemsCount(){ return 1;}
+    QString lastError(){ return m_error;}
+    void setPassPhrase(const QString &passPhrase){ Q_UNUSED(passPhrase) }
+private:
+    TemplateReader(ReportTemplate::Ptr reportTemplate)
+        : m_template(reportTemplate), m_current(false){}
+    ReportTemplate::Ptr m_template;
+    bool m_current;
+    QString m_error;
+};
+
+class ReportTemplateCache : public Singleton<ReportTemplateCache>{
+    friend class Singleton<ReportTemplateCache>;
+public:
+    ItemsReaderIntf::Ptr fileReader(const QString& fileName, const QString& passPhrase);
+    ItemsReaderIntf::Ptr byteArrayReader(QByteArray* data, const QString& passPhrase);
+    ItemsReaderIntf::Ptr stringReader(const QString& data, const QString& passPhrase);
+    void clear();
+private:
+    struct CacheEntry{
+        QDateTime lastModified;
+        qint64 size;
+        QString passPhrase;
+        ReportTemplate::Ptr reportTemplate;
+    };
+    ReportTemplateCache(): m_templates(Const::MAX_REPORT_TEMPLATES){}
+    ReportTemplate::Ptr findTemplate(const QString& key, const QDateTime& lastModified, qint64 size, const QString& passPhrase);
+    ReportTemplate::Ptr parseTemplate(ItemsReaderIntf::Ptr xmlReader, const QString& key,
+                                      const QDateTime& lastModified, qint64 size, const QString& passPhrase);
+private:
+    QMutex m_mutex;
+    // the least recently loaded templates are dropped first
+    QCache<QString, CacheEntry> m_templates;
+};
+
+}
+#endif // LRREPORTTEMPLATE_H
@@ -140,6 +140,72 @@ void XMLReader::readItemFromNode(QObject* item,QDomElement *node)
     EASY_END_BLOCK;
 }
 
+ReportTemplate::Ptr XMLReader::readTemplate()
+{
+    if (m_curNode.isNull()){
+        m_error = QString("Template node not founded");
+        return ReportTemplate::Ptr();
+    }
+    ReportTemplateNode root;
+    root.type = ReportTemplateNode::ObjectNode;
+    root.name = m_curNode.nodeName();
+    root.className = m_curNode.attribute("ClassName");
+    readTemplateNode(&m_curNode, &root);
+    return ReportTemplate::Ptr(new ReportTemplate(root));
+}
+
+void XMLReader::readTemplateNode(QDomElement *node, ReportTemplateNode *templateNode)
+{
+    for (int i=0;i<node->childNodes().count();i++){
+        QDomElement currentNode =node->childNodes().at(i).toElement();
+        ReportTemplateNode child;
+        child.name = currentNode.nodeName();
+        child.className = currentNode.attribute("ClassName");
+        if (currentNode.attribute("Type")=="Object"){
+            child.type = ReportTemplateNode::ObjectNode;
+            child.propertyName = child.name.toLatin1();
+            readTemplateNode(&currentNode, &child);
+        } else if (currentNode.attribute("Type")=="Collection"){
+            child.type = ReportTemplateNode::CollectionNode;
+            for(int j = 0; j < currentNode.childNodes().count(); ++j){
+                QDomElement elementNode = currentNode.childNodes().at(j).toElement();
+                ReportTemplateNode element;
+                element.type = ReportTemplateNode::ObjectNode;
+                element.name = elementNode.nodeName();
+                element.className = elementNode.attribute("ClassName");
+                readTemplateNode(&elementNode, &element);
+                child.children.append(element);
+            }
+        } else if (currentNode.attribute("Type")=="Translation"){
+            readTranslationTemplateNode(&currentNode, &child);
+        } else {
+            child.type = ReportTemplateNode::PropertyNode;
+            child.propertyName = child.name.toLatin1();
+            child.value = getValue(&currentNode);
+        }
+        templateNode->children.append(child);
+    }
+}
+
+void XMLReader::readTranslationTemplateNode(QDomElement *node, ReportTemplateNode *templateNode)
+{
+    templateNode->type = ReportTemplateNode::TranslationNode;
+    templateNode->name = node->nodeName();
+    QVariantMap attributes;
+    QDomNamedNodeMap nodeAttributes = node->attributes();
+    for (int i = 0; i < nodeAttributes.count(); ++i){
+        QDomAttr attribute = nodeAttributes.item(i).toAttr();
+        attributes.insert(attribute.name(), attribute.value());
+    }
+    templateNode->value = attributes;
+    for (int i = 0; i < node->childNodes().count(); ++i){
+        QDomElement currentNode = node->childNodes().at(i).toElement();
+        ReportTemplateNode child;
+        readTranslationTemplateNode(&currentNode, &child);
+        templateNode->children.append(child);
+    }
+}
+
 QString XMLReader::lastError()
 {
     return m_error;
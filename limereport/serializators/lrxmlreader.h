@@ -34,6 +34,7 @@
 #include <QtXml>
 
 #include "serializators/lrxmlwriter.h"
+#include "serializators/lrreporttemplate.h"
 #include "lrdesignelementsfactory.h"
 
 namespace LimeReport{
@@ -43,6 +44,7 @@ class XMLReader : public ItemsReaderIntf
 public:
     XMLReader();
     XMLReader(QSharedPointer<QDomDocument> doc);
+    ReportTemplate::Ptr readTemplate();
 protected:
 //ItemsReaderIntf interface
     bool first();
@@ -64,6 +66,9 @@ protected:
     void readTranslation(QObject *item, QDomElement *node);
     QVariant getValue(QDomElement *node);
 
+    void readTemplateNode(QDomElement *node, ReportTemplateNode *templateNode);
+    void readTranslationTemplateNode(QDomElement *node, ReportTemplateNode *templateNode);
+
 protected:
     bool extractFirstNode();
     QString m_error;
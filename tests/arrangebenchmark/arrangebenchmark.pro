@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_arrangebenchmark
+
+SOURCES += \
+        tst_arrangebenchmark.cpp
@@ -0,0 +1,263 @@
+#include <QString>
+#include <QtTest>
+#include <algorithm>
+#include "../../limereport/lritemdesignintf.h"
+#include "../../limereport/lritemscontainerdesignitf.h"
+#include "../../limereport/bands/lrdataband.h"
+
+namespace {
+
+const qreal CELL_WIDTH = 100;
+const qreal CELL_HEIGHT = 50;
+const qreal CELL_SPACE = 2;
+const qreal GROWN_HEIGHT = 80;
+const qreal SECOND_ROW_TOP = 60;
+
+// An item which gets the given size when it is rendered, an invalid size keeps its own
+class CellItem : public LimeReport::ItemDesignIntf{
+public:
+    CellItem(const QSizeF& renderedSize, QObject* owner = 0, QGraphicsItem* parent = 0)
+        : LimeReport::ItemDesignIntf("CellItem", owner, parent), m_renderedSize(renderedSize){}
+    bool isNeedUpdateSize(LimeReport::RenderPass) const { return m_renderedSize.isValid(); }
+    void updateItemSize(LimeReport::DataSourceManager*, LimeReport::RenderPass, int){
+        if (m_renderedSize.isValid()) setSize(m_renderedSize);
+    }
+protected:
+    LimeReport::BaseDesignIntf* createSameTypeItem(QObject* owner = 0, QGraphicsItem* parent = 0){
+        return new CellItem(m_renderedSize, owner, parent);
+    }
+private:
+    QSizeF m_renderedSize;
+};
+
+struct CellDesc{
+    CellDesc(){}
+    CellDesc(const QRectF& geometry, const QSizeF& renderedSize = QSizeF())
+        : geometry(geometry), renderedSize(renderedSize){}
+    QRectF geometry;
+    QSizeF renderedSize;
+};
+
+// The check of every pair of items which arrangeSubItems did before the sweep
+void pairwiseArrange(const QList<CellItem*>& cells){
+    QVector<LimeReport::PItemSortContainer> items;
+    foreach(CellItem* cell, cells)
+        items.append(LimeReport::PItemSortContainer(new LimeReport::ItemSortContainer(cell)));
+    std::sort(items.begin(), items.end(), LimeReport::itemSortContainerLessThen);
+    foreach(LimeReport::PItemSortContainer item, items){
+        if (item->m_item->isNeedUpdateSize(LimeReport::FirstPass))
+            item->m_item->updateItemSize(0, LimeReport::FirstPass);
+    }
+    for (int i = 0; i < items.count(); i++){
+        for (int j = i; j < items.count(); j++){
+            if ((i != j) && (items[i]->m_item->collidesWithItem(items[j]->m_item))){
+                LimeReport::HSegment hS1(items[j]->m_rect), hS2(items[i]->m_rect);
+                LimeReport::VSegment vS1(items[j]->m_rect), vS2(items[i]->m_rect);
+                if (items[i]->m_rect.bottom() < items[i]->m_item->geometry().bottom()){
+                    if (hS1.intersectValue(hS2) > vS1.intersectValue(vS2))
+                        items[j]->m_item->setY(items[i]->m_item->y() + items[i]->m_item->height()
+                                               + items[j]->m_rect.top() - items[i]->m_rect.bottom());
+                }
+                if (items[i]->m_rect.right() < items[i]->m_item->geometry().right()){
+                    if (vS1.intersectValue(vS2) > hS1.intersectValue(hS2))
+                        items[j]->m_item->setX(items[i]->m_item->geometry().right()
+                                               + (items[j]->m_rect.x() - items[i]->m_rect.right()));
+                }
+            }
+        }
+    }
+}
+
+// Arranges the cells in a band and with pairwiseArrange and compares the results
+class ArrangeComparison{
+public:
+    ArrangeComparison(const QList<CellDesc>& cells){
+        m_band.setWidth(2000);
+        m_band.setHeight(2000);
+        // the items are compared where arrangeSubItems left them
+        m_band.setKeepTopSpace(true);
+        foreach(const CellDesc& desc, cells){
+            m_bandCells.append(createCell(desc, &m_band));
+            m_pairwiseCells.append(createCell(desc, &m_container));
+        }
+    }
+    void arrange(){
+        m_band.updateItemSize(0, LimeReport::FirstPass);
+        pairwiseArrange(m_pairwiseCells);
+    }
+    QList<CellItem*> bandCells() const { return m_bandCells; }
+    QList<CellItem*> pairwiseCells() const { return m_pairwiseCells; }
+private:
+    static CellItem* createCell(const CellDesc& desc, LimeReport::BaseDesignIntf* parent){
+        CellItem* cell = new CellItem(desc.renderedSize, parent, parent);
+        cell->setGeometry(desc.geometry);
+        return cell;
+    }
+private:
+    LimeReport::DataBand m_band;
+    LimeReport::DataBand m_container;
+    QList<CellItem*> m_bandCells;
+    QList<CellItem*> m_pairwiseCells;
+};
+
+// Deterministic pseudo random numbers, the same layouts on every run
+class RandomNumbers{
+public:
+    RandomNumbers(quint32 seed): m_value(seed){}
+    int next(int limit){
+        m_value = m_value * 1103515245u + 12345u;
+        return int((m_value >> 16) % quint32(limit));
+    }
+private:
+    quint32 m_value;
+};
+
+// Two rows of cells: the first row grows and has to push the second one down
+class WideBand{
+public:
+    WideBand(int columns){
+        m_band.setWidth(columns * (CELL_WIDTH + CELL_SPACE));
+        m_band.setHeight(SECOND_ROW_TOP + CELL_HEIGHT);
+        for (int i = 0; i < columns; ++i){
+            CellItem* top = new CellItem(QSizeF(CELL_WIDTH, GROWN_HEIGHT), &m_band, &m_band);
+            top->setGeometry(QRectF(i * (CELL_WIDTH + CELL_SPACE), 0, CELL_WIDTH, CELL_HEIGHT));
+            m_topRow.append(top);
+            CellItem* bottom = new CellItem(QSizeF(), &m_band, &m_band);
+            bottom->setGeometry(QRectF(i * (CELL_WIDTH + CELL_SPACE), SECOND_ROW_TOP, CELL_WIDTH, CELL_HEIGHT));
+            m_bottomRow.append(bottom);
+        }
+    }
+    void reset(){
+        foreach(CellItem* item, m_topRow) item->setHeight(CELL_HEIGHT);
+        foreach(CellItem* item, m_bottomRow) item->setY(SECOND_ROW_TOP);
+        m_band.setHeight(SECOND_ROW_TOP + CELL_HEIGHT);
+    }
+    void arrange(){ m_band.updateItemSize(0, LimeReport::FirstPass); }
+    QList<CellItem*> bottomRow() const { return m_bottomRow; }
+private:
+    LimeReport::DataBand m_band;
+    QList<CellItem*> m_topRow;
+    QList<CellItem*> m_bottomRow;
+};
+
+} // namespace
+
+Q_DECLARE_METATYPE(QList<CellDesc>)
+
+class ArrangeBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testArrange();
+    void testSameAsPairwise_data();
+    void testSameAsPairwise();
+    void testRandomLayouts();
+    void benchmarkWideBand_data();
+    void benchmarkWideBand();
+};
+
+void ArrangeBenchmark::testArrange()
+{
+    WideBand band(120);
+    band.arrange();
+    foreach(CellItem* item, band.bottomRow())
+        QCOMPARE(item->y(), GROWN_HEIGHT + SECOND_ROW_TOP - CELL_HEIGHT);
+}
+
+void ArrangeBenchmark::testSameAsPairwise_data()
+{
+    QTest::addColumn<QList<CellDesc> >("cells");
+    QTest::newRow("below a shrinking neighbour")
+            << (QList<CellDesc>()
+                << CellDesc(QRectF(0, 0, 100, 50), QSizeF(100, 20))
+                << CellDesc(QRectF(0, 60, 100, 50)));
+    QTest::newRow("below a shrinking neighbour of a growing one")
+            << (QList<CellDesc>()
+                << CellDesc(QRectF(0, 0, 100, 50), QSizeF(100, 90))
+                << CellDesc(QRectF(0, 60, 100, 50), QSizeF(100, 10))
+                << CellDesc(QRectF(0, 120, 100, 50))
+                << CellDesc(QRectF(0, 180, 100, 50)));
+    QTest::newRow("below a pushed down and shrinking neighbour")
+            << (QList<CellDesc>()
+                << CellDesc(QRectF(0, 0, 100, 50), QSizeF(100, 200))
+                << CellDesc(QRectF(0, 60, 100, 50), QSizeF(100, 30))
+                << CellDesc(QRectF(0, 120, 100, 50)));
+    QTest::newRow("overlapping neighbours")
+            << (QList<CellDesc>()
+                << CellDesc(QRectF(0, 0, 100, 50), QSizeF(100, 80))
+                << CellDesc(QRectF(50, 30, 100, 50))
+                << CellDesc(QRectF(20, 40, 100, 50), QSizeF(100, 70))
+                << CellDesc(QRectF(0, 100, 150, 50)));
+    QTest::newRow("overlapping neighbours growing to the right")
+            << (QList<CellDesc>()
+                << CellDesc(QRectF(0, 0, 100, 50), QSizeF(180, 50))
+                << CellDesc(QRectF(90, 10, 100, 50))
+                << CellDesc(QRectF(200, 0, 100, 50), QSizeF(130, 60))
+                << CellDesc(QRectF(310, 20, 100, 50)));
+}
+
+void ArrangeBenchmark::testSameAsPairwise()
+{
+    QFETCH(QList<CellDesc>, cells);
+    ArrangeComparison comparison(cells);
+    comparison.arrange();
+    for (int i = 0; i < cells.count(); ++i){
+        QCOMPARE(comparison.bandCells().at(i)->pos(), comparison.pairwiseCells().at(i)->pos());
+        QCOMPARE(comparison.bandCells().at(i)->size(), comparison.pairwiseCells().at(i)->size());
+    }
+}
+
+void ArrangeBenchmark::testRandomLayouts()
+{
+    // crowded layouts with growing, shrinking and overlapping items
+    RandomNumbers random(20261018);
+    for (int layout = 0; layout < 200; ++layout){
+        QList<CellDesc> cells;
+        for (int i = 0; i < 3 + random.next(20); ++i){
+            QRectF geometry(random.next(600), random.next(600), 20 + random.next(150), 20 + random.next(100));
+            QSizeF renderedSize;
+            switch (random.next(4)) {
+            case 0:
+                renderedSize = QSizeF(geometry.width(), 10 + random.next(200));
+                break;
+            case 1:
+                renderedSize = QSizeF(10 + random.next(200), geometry.height());
+                break;
+            default:
+                break;
+            }
+            cells.append(CellDesc(geometry, renderedSize));
+        }
+        ArrangeComparison comparison(cells);
+        comparison.arrange();
+        for (int i = 0; i < cells.count(); ++i){
+            QVERIFY2(comparison.bandCells().at(i)->pos() == comparison.pairwiseCells().at(i)->pos(),
+                     qPrintable(QString("layout %1, item %2").arg(layout).arg(i)));
+        }
+    }
+}
+
+void ArrangeBenchmark::benchmarkWideBand_data()
+{
+    QTest::addColumn<int>("columns");
+    QTest::newRow("30 columns") << 30;
+    QTest::newRow("60 columns") << 60;
+    QTest::newRow("120 columns") << 120;
+    QTest::newRow("240 columns") << 240;
+    QTest::newRow("480 columns") << 480;
+}
+
+void ArrangeBenchmark::benchmarkWideBand()
+{
+    QFETCH(int, columns);
+    WideBand band(columns);
+    QBENCHMARK {
+        band.reset();
+        band.arrange();
+    }
+}
+
+QTEST_MAIN(ArrangeBenchmark)
+
+#include "tst_arrangebenchmark.moc"
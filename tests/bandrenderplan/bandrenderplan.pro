@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_bandrenderplan
+
+SOURCES += \
+        tst_bandrenderplan.cpp
@@ -0,0 +1,242 @@
+#include <QString>
+#include <QStringList>
+#include <QMetaProperty>
+#include <QStandardItemModel>
+#include <QtTest>
+#include "../../limereport/lrreportrender.h"
+#include "../../limereport/lrreportengine.h"
+#include "../../limereport/lrdatasourcemanagerintf.h"
+#include "../../limereport/lrpagesinkintf.h"
+#include "../../limereport/bands/lrdataband.h"
+#include "../../limereport/items/lrtextitem.h"
+
+namespace {
+
+const int ITEMS_COUNT = 20;
+const int ROWS_COUNT = 2000;
+
+// A data band laid out like a wide detail row of a table report
+LimeReport::DataBand* createPatternBand(){
+    LimeReport::DataBand* band = new LimeReport::DataBand();
+    band->setObjectName("DataBand1");
+    band->setGeometry(QRectF(0, 0, 2000, 40));
+    for (int i = 0; i < ITEMS_COUNT; ++i){
+        LimeReport::TextItem* item = new LimeReport::TextItem(band, band);
+        item->setObjectName(QString("TextItem%1").arg(i + 1));
+        item->setGeometry(QRectF(i * 100, 0, 100, 40));
+        item->setContent(QString("$D{orders.field%1}").arg(i + 1));
+        item->setProperty("borders", int(LimeReport::BaseDesignIntf::AllLines));
+        item->setProperty("alignment", int(Qt::AlignRight | Qt::AlignVCenter));
+        item->setProperty("fontColor", QColor(Qt::darkBlue));
+        item->setProperty("margin", 5);
+    }
+    return band;
+}
+
+QStringList itemValues(LimeReport::BaseDesignIntf* item){
+    QStringList result;
+    const QMetaObject* metaObject = item->metaObject();
+    for (int i = 0; i < metaObject->propertyCount(); ++i){
+        QMetaProperty metaProperty = metaObject->property(i);
+        if (metaProperty.isWritable())
+            result.append(QString("%1=%2").arg(metaProperty.name()).arg(metaProperty.read(item).toString()));
+    }
+    return result;
+}
+
+QStringList bandValues(LimeReport::BandDesignIntf* band){
+    QStringList result = itemValues(band);
+    foreach (LimeReport::BaseDesignIntf* item, band->childBaseItems())
+        result.append(item->objectName() + ":" + itemValues(item).join(";"));
+    return result;
+}
+
+// A report with the pattern band above as its detail band
+QString reportTemplate(){
+    QString items;
+    for (int i = 0; i < ITEMS_COUNT; ++i){
+        items += QString(
+            "<item Type=\"Object\" ClassName=\"TextItem\">"
+            "<objectName Type=\"QString\">TextItem%1</objectName>"
+            "<geometry x=\"%2\" width=\"100\" Type=\"QRect\" y=\"0\" height=\"40\"/>"
+            "<children Type=\"Collection\"/>"
+            "<parentName Type=\"QString\">DataBand1</parentName>"
+            "<content Type=\"QString\">$D{orders.field%1}</content>"
+            "<margin Type=\"int\">5</margin>"
+            "</item>"
+        ).arg(i + 1).arg(i * 100);
+    }
+    return QString(
+        "<?xml version=\"1.0\" encoding=\"UTF8\"?><Report>"
+        "<object Type=\"Object\" ClassName=\"LimeReport::ReportEnginePrivate\">"
+        "<objectName Type=\"QString\"></objectName><pages Type=\"Collection\">"
+        "<item Type=\"Object\" ClassName=\"LimeReport::PageDesignIntf\">"
+        "<objectName Type=\"QString\">page1</objectName>"
+        "<pageItem Type=\"Object\" ClassName=\"PageItem\">"
+        "<objectName Type=\"QString\">ReportPage1</objectName>"
+        "<geometry x=\"0\" width=\"2100\" Type=\"QRect\" y=\"0\" height=\"2970\"/>"
+        "<children Type=\"Collection\">"
+        "<item Type=\"Object\" ClassName=\"Data\">"
+        "<objectName Type=\"QString\">DataBand1</objectName>"
+        "<geometry x=\"50\" width=\"2000\" Type=\"QRect\" y=\"50\" height=\"40\"/>"
+        "<children Type=\"Collection\">%1</children>"
+        "<datasource Type=\"QString\">orders</datasource>"
+        "</item></children></pageItem></item></pages></object></Report>"
+    ).arg(items);
+}
+
+class NullPageSink : public LimeReport::IPageSink{
+public:
+    NullPageSink(): m_pagesCount(0){}
+    bool startPages(){ m_pagesCount = 0; return true; }
+    bool putPage(QSharedPointer<LimeReport::PageItemDesignIntf> page){ Q_UNUSED(page); ++m_pagesCount; return true; }
+    bool finishPages(){ return true; }
+    int pagesCount() const { return m_pagesCount; }
+private:
+    int m_pagesCount;
+};
+
+} // namespace
+
+class BandRenderPlanTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+    void testSameAsClone();
+    void testChangedPattern();
+    void testUnreportedProperty();
+    void testPageDependency();
+    void benchmarkInstantiate_data();
+    void benchmarkInstantiate();
+    void benchmarkRenderRows();
+private:
+    LimeReport::DataBand* m_patternBand;
+};
+
+void BandRenderPlanTest::init()
+{
+    m_patternBand = createPatternBand();
+}
+
+void BandRenderPlanTest::cleanup()
+{
+    delete m_patternBand;
+    m_patternBand = 0;
+}
+
+void BandRenderPlanTest::testSameAsClone()
+{
+    LimeReport::BandRenderPlan plan(m_patternBand);
+    QScopedPointer<LimeReport::BandDesignIntf> clone(
+        dynamic_cast<LimeReport::BandDesignIntf*>(m_patternBand->cloneItem(LimeReport::BaseDesignIntf::PreviewMode))
+    );
+    for (int i = 0; i < 2; ++i){
+        QScopedPointer<LimeReport::BandDesignIntf> instance(plan.instantiate(LimeReport::BaseDesignIntf::PreviewMode));
+        QCOMPARE(instance->childBaseItems().count(), ITEMS_COUNT);
+        QCOMPARE(bandValues(instance.data()), bandValues(clone.data()));
+    }
+}
+
+void BandRenderPlanTest::testChangedPattern()
+{
+    LimeReport::BandRenderPlan plan(m_patternBand);
+    delete plan.instantiate(LimeReport::BaseDesignIntf::PreviewMode);
+
+    LimeReport::TextItem* patternItem = m_patternBand->findChild<LimeReport::TextItem*>("TextItem1");
+    QVERIFY(patternItem);
+    patternItem->setContent("changed by a script");
+    patternItem->setProperty("alignment", int(Qt::AlignLeft | Qt::AlignTop));
+
+    QScopedPointer<LimeReport::BandDesignIntf> instance(plan.instantiate(LimeReport::BaseDesignIntf::PreviewMode));
+    LimeReport::TextItem* item = instance->findChild<LimeReport::TextItem*>("TextItem1");
+    QVERIFY(item);
+    QCOMPARE(item->content(), QString("changed by a script"));
+    QCOMPARE(item->alignment(), Qt::AlignLeft | Qt::AlignTop);
+}
+
+void BandRenderPlanTest::testUnreportedProperty()
+{
+    // setFormat() doesn't report the change, the value is read for every instance
+    LimeReport::BandRenderPlan plan(m_patternBand);
+    delete plan.instantiate(LimeReport::BaseDesignIntf::PreviewMode);
+
+    LimeReport::TextItem* patternItem = m_patternBand->findChild<LimeReport::TextItem*>("TextItem1");
+    QVERIFY(patternItem);
+    int revision = patternItem->propertiesRevision();
+    patternItem->setFormat("0.00");
+    QCOMPARE(patternItem->propertiesRevision(), revision);
+
+    QScopedPointer<LimeReport::BandDesignIntf> instance(plan.instantiate(LimeReport::BaseDesignIntf::PreviewMode));
+    LimeReport::TextItem* item = instance->findChild<LimeReport::TextItem*>("TextItem1");
+    QVERIFY(item);
+    QCOMPARE(item->format(), QString("0.00"));
+}
+
+void BandRenderPlanTest::testPageDependency()
+{
+    LimeReport::BandRenderPlan plan(m_patternBand);
+    QVERIFY(!plan.isPageDependent());
+
+    LimeReport::TextItem* patternItem = m_patternBand->findChild<LimeReport::TextItem*>("TextItem1");
+    QVERIFY(patternItem);
+    patternItem->setContent("$V{#PAGE}");
+    QVERIFY(plan.isPageDependent());
+    patternItem->setContent("$D{orders.field1}");
+    QVERIFY(!plan.isPageDependent());
+
+    // an unreported change is seen with the next instance
+    patternItem->setFormat("$V{format}");
+    delete plan.instantiate(LimeReport::BaseDesignIntf::PreviewMode);
+    QVERIFY(plan.isPageDependent());
+}
+
+void BandRenderPlanTest::benchmarkInstantiate_data()
+{
+    QTest::addColumn<bool>("usePlan");
+    QTest::newRow("cloneItem") << false;
+    QTest::newRow("render plan") << true;
+}
+
+void BandRenderPlanTest::benchmarkInstantiate()
+{
+    QFETCH(bool, usePlan);
+    LimeReport::BandRenderPlan plan(m_patternBand);
+    QBENCHMARK {
+        if (usePlan)
+            delete plan.instantiate(LimeReport::BaseDesignIntf::PreviewMode);
+        else
+            delete m_patternBand->cloneItem(LimeReport::BaseDesignIntf::PreviewMode);
+    }
+}
+
+void BandRenderPlanTest::benchmarkRenderRows()
+{
+    // the whole per-row path of a wide detail band, benchmarkInstantiate()
+    // compares its instantiation part with cloneItem()
+    QStandardItemModel model(ROWS_COUNT, ITEMS_COUNT);
+    QStringList headers;
+    for (int column = 0; column < ITEMS_COUNT; ++column){
+        headers.append(QString("field%1").arg(column + 1));
+        for (int row = 0; row < ROWS_COUNT; ++row)
+            model.setItem(row, column, new QStandardItem(QString::number(row * ITEMS_COUNT + column)));
+    }
+    model.setHorizontalHeaderLabels(headers);
+
+    LimeReport::ReportEngine report;
+    report.setRenderMode(LimeReport::HeadlessRenderMode);
+    report.dataManager()->addModel("orders", &model, false);
+    QVERIFY(report.loadFromString(reportTemplate()));
+
+    NullPageSink sink;
+    QBENCHMARK {
+        QVERIFY(report.renderToPageSink(&sink));
+    }
+    QVERIFY(sink.pagesCount() > 1);
+}
+
+QTEST_MAIN(BandRenderPlanTest)
+
+#include "tst_bandrenderplan.moc"
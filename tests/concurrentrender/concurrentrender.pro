@@ -0,0 +1,8 @@
+include(../tests.pri)
+
+TARGET = tst_concurrentrendertest
+
+SOURCES += \
+        tst_concurrentrendertest.cpp
+
+DEFINES += SRCDIR=\\\"$$PWD/\\\"
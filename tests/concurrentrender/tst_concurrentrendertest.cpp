@@ -0,0 +1,206 @@
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QStandardItemModel>
+#include <QtTest>
+#include "../../limereport/lrreportengine.h"
+#include "../../limereport/lrdatasourcemanagerintf.h"
+#include "../../limereport/lrpagesinkintf.h"
+#include "../../limereport/lrexportersfactory.h"
+#include "../../limereport/lrpageitemdesignintf.h"
+#include "../../limereport/lritemdesignintf.h"
+
+namespace {
+
+const int ROWS_COUNT = 200;
+// enough rows for the streamed pages to overflow the in-memory spool
+const int STREAMED_ROWS_COUNT = 2000;
+const int THREADS_COUNT = 16;
+const char* CONTENT_EXPORTER = "ContentText";
+
+enum RenderPath{
+    PageSinkPath,
+    // exportReport() of the whole page list made by renderToPages()
+    ExportPagesPath,
+    // exportReport() with the pages streamed to the exporter
+    StreamedExportPath
+};
+
+class ContentCollector : public LimeReport::IPageSink{
+public:
+    bool startPages(){ m_contents.clear(); return true; }
+    bool putPage(QSharedPointer<LimeReport::PageItemDesignIntf> page){
+        m_contents.append(QString("page:%1").arg(m_contents.count()));
+        collect(page.data());
+        return true;
+    }
+    bool finishPages(){ return true; }
+    QStringList contents() const { return m_contents; }
+private:
+    void collect(LimeReport::BaseDesignIntf* item){
+        foreach(LimeReport::BaseDesignIntf* child, item->childBaseItems()){
+            LimeReport::ContentItemDesignIntf* contentItem = dynamic_cast<LimeReport::ContentItemDesignIntf*>(child);
+            if (contentItem)
+                m_contents.append(child->objectName() + "=" + contentItem->content());
+            collect(child);
+        }
+    }
+private:
+    QStringList m_contents;
+};
+
+// Writes the collected contents to a text file, one line each
+class ContentExporter : public LimeReport::ReportExporterInterface,
+                        public LimeReport::ReportExporterPageSinkInterface{
+public:
+    bool exportPages(LimeReport::ReportPages pages, const QString& fileName, const QMap<QString, QVariant>& params){
+        Q_UNUSED(params);
+        ContentCollector collector;
+        collector.startPages();
+        foreach(QSharedPointer<LimeReport::PageItemDesignIntf> page, pages)
+            collector.putPage(page);
+        return writeContents(fileName, collector.contents());
+    }
+    QString exporterName(){ return CONTENT_EXPORTER; }
+    QString exporterFileExt(){ return "txt"; }
+    QString hint(){ return QString(); }
+    void setExportParams(const QString& fileName, const QMap<QString, QVariant>& params){
+        Q_UNUSED(params);
+        m_fileName = fileName;
+    }
+    bool startPages(){ return m_collector.startPages(); }
+    bool putPage(QSharedPointer<LimeReport::PageItemDesignIntf> page){ return m_collector.putPage(page); }
+    bool finishPages(){ return writeContents(m_fileName, m_collector.contents()); }
+private:
+    bool writeContents(const QString& fileName, const QStringList& contents){
+        QFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) return false;
+        return file.write(contents.join("\n").toUtf8()) >= 0;
+    }
+private:
+    QString m_fileName;
+    ContentCollector m_collector;
+};
+
+LimeReport::ReportExporterInterface* createContentExporter(LimeReport::ReportEnginePrivate* parent){
+    Q_UNUSED(parent);
+    return new ContentExporter();
+}
+
+QStringList readContents(const QString& fileName){
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return QStringList();
+    return QString::fromUtf8(file.readAll()).split("\n");
+}
+
+QStringList renderReport(RenderPath path = PageSinkPath, int rowsCount = ROWS_COUNT,
+                         const QString& fileName = QString()){
+    QStandardItemModel model(rowsCount, 2);
+    for (int i = 0; i < rowsCount; ++i){
+        model.setItem(i, 0, new QStandardItem(QString("Name %1").arg(i + 1)));
+        model.setItem(i, 1, new QStandardItem(QString::number(i + 1)));
+    }
+    model.setHorizontalHeaderLabels(QStringList() << "Name" << "Value");
+
+    LimeReport::ReportEngine report;
+    report.setRenderMode(LimeReport::HeadlessRenderMode);
+    report.dataManager()->addModel("rows", &model, false);
+    report.dataManager()->setReportVariable("rowTitle", "Value");
+    if (!report.loadFromFile(QString(SRCDIR) + "concurrent_report.lrxml"))
+        return QStringList();
+
+    if (path == PageSinkPath){
+        ContentCollector collector;
+        if (!report.renderToPageSink(&collector))
+            return QStringList();
+        return collector.contents();
+    }
+    report.setPageStreaming(path == StreamedExportPath);
+    if (!report.exportReport(CONTENT_EXPORTER, fileName))
+        return QStringList();
+    return readContents(fileName);
+}
+
+class RenderThread : public QThread{
+public:
+    RenderThread(RenderPath path, const QString& fileName)
+        : m_path(path), m_fileName(fileName){}
+    QStringList result() const { return m_result; }
+protected:
+    void run(){ m_result = renderReport(m_path, ROWS_COUNT, m_fileName); }
+private:
+    RenderPath m_path;
+    QString m_fileName;
+    QStringList m_result;
+};
+
+} // namespace
+
+class ConcurrentRenderTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void testConcurrentRender_data();
+    void testConcurrentRender();
+    void testStreamedPageCount();
+private:
+    QStringList m_baseline;
+};
+
+void ConcurrentRenderTest::initTestCase()
+{
+    // factories are filled before any worker thread is started
+    LimeReport::ExportersFactory::instance().registerCreator(
+        CONTENT_EXPORTER, LimeReport::ExporterAttribs("Export contents", "ContentExporter"), createContentExporter
+    );
+    m_baseline = renderReport();
+    QVERIFY(!m_baseline.isEmpty());
+    QVERIFY(m_baseline.contains("TextItem1=Name 1"));
+    QVERIFY(m_baseline.contains(QString("TextItem1=Name %1").arg(ROWS_COUNT)));
+    QVERIFY(m_baseline.contains("TextItem4=Total: 20100"));
+    QVERIFY(m_baseline.contains(QString("TextItem5=Count: %1").arg(ROWS_COUNT)));
+}
+
+void ConcurrentRenderTest::testConcurrentRender_data()
+{
+    QTest::addColumn<int>("path");
+    QTest::newRow("page sink") << int(PageSinkPath);
+    QTest::newRow("export rendered pages") << int(ExportPagesPath);
+    QTest::newRow("streamed export") << int(StreamedExportPath);
+}
+
+void ConcurrentRenderTest::testConcurrentRender()
+{
+    QFETCH(int, path);
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QList<RenderThread*> threads;
+    for (int i = 0; i < THREADS_COUNT; ++i)
+        threads.append(new RenderThread(RenderPath(path), dir.path() + QString("/report%1.txt").arg(i)));
+    foreach(RenderThread* thread, threads)
+        thread->start();
+    foreach(RenderThread* thread, threads)
+        QVERIFY(thread->wait(120000));
+    foreach(RenderThread* thread, threads)
+        QCOMPARE(thread->result(), m_baseline);
+    qDeleteAll(threads);
+}
+
+void ConcurrentRenderTest::testStreamedPageCount()
+{
+    QStringList contents = renderReport(PageSinkPath, STREAMED_ROWS_COUNT);
+    QStringList pageFooters = contents.filter("TextItem6=");
+    QVERIFY(pageFooters.count() > 16);
+    QCOMPARE(pageFooters.count(), contents.filter("page:").count());
+    for (int i = 0; i < pageFooters.count(); ++i)
+        QCOMPARE(pageFooters.at(i), QString("TextItem6=Page %1 of %2").arg(i + 1).arg(pageFooters.count()));
+}
+
+QTEST_MAIN(ConcurrentRenderTest)
+
+#include "tst_concurrentrendertest.moc"
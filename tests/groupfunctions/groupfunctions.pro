@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_groupfunctions
+
+SOURCES += \
+        tst_groupfunctions.cpp
@@ -0,0 +1,159 @@
+#include <QString>
+#include <QtTest>
+#include "../../limereport/lrgroupfunctions.h"
+#include "../../limereport/lrpageitemdesignintf.h"
+#include "../../limereport/bands/lrdataband.h"
+#include "../../limereport/bands/lrpageheader.h"
+
+namespace {
+
+const char* EXPRESSION = "$D{orders.value}";
+const char* DATA_BAND_NAME = "DataBand1";
+
+// A data band which gave the group function the value, as slotBandRendered() does
+LimeReport::DataBand* addDataBand(LimeReport::PageItemDesignIntf* page, LimeReport::GroupFunction* gf,
+                                  const QVariant& value){
+    LimeReport::DataBand* band = new LimeReport::DataBand();
+    band->setObjectName(DATA_BAND_NAME);
+    band->setBandIndex(page->childBands().count());
+    gf->pushValue(value);
+    band->setGroupFunctionValue(gf, value);
+    page->registerBand(band);
+    return band;
+}
+
+void addPageHeader(LimeReport::PageItemDesignIntf* page){
+    LimeReport::PageHeader* band = new LimeReport::PageHeader();
+    band->setBandIndex(page->childBands().count());
+    page->registerBand(band);
+}
+
+} // namespace
+
+class GroupFunctionsTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testPageSum();
+    void testPageMinMaxSkipBandsWithoutValue();
+    void testPageAvg();
+    void testEmptyAvg();
+    void testPopValue();
+    void testReRenderedBand();
+    void testRemovedBand();
+};
+
+void GroupFunctionsTest::testPageSum()
+{
+    LimeReport::PageItemDesignIntf::Ptr page = LimeReport::PageItemDesignIntf::create(0);
+    LimeReport::SumGroupFunction sum(EXPRESSION, DATA_BAND_NAME, 0);
+    LimeReport::GroupFunction* gf = &sum;
+    addPageHeader(page.data());
+    addDataBand(page.data(), gf, 1.5);
+    addDataBand(page.data(), gf, 2.5);
+    // a null value counts as 0 in the sum, as before
+    addDataBand(page.data(), gf, QVariant());
+    QCOMPARE(gf->calculate(page.data()).toDouble(), 4.0);
+
+    LimeReport::PageItemDesignIntf::Ptr nextPage = LimeReport::PageItemDesignIntf::create(0);
+    addDataBand(nextPage.data(), gf, 10);
+    QCOMPARE(gf->calculate(nextPage.data()).toDouble(), 10.0);
+    QCOMPARE(gf->calculate().toDouble(), 14.0);
+}
+
+void GroupFunctionsTest::testPageMinMaxSkipBandsWithoutValue()
+{
+    // Bands without a value, like the page header here, used to count as 0 in
+    // the page MIN and MAX; they are ignored now.
+    LimeReport::PageItemDesignIntf::Ptr page = LimeReport::PageItemDesignIntf::create(0);
+    LimeReport::MinGroupFunction min(EXPRESSION, DATA_BAND_NAME, 0);
+    LimeReport::MaxGroupFunction max(EXPRESSION, DATA_BAND_NAME, 0);
+    LimeReport::GroupFunction* minFunction = &min;
+    LimeReport::GroupFunction* maxFunction = &max;
+    addPageHeader(page.data());
+    addDataBand(page.data(), minFunction, 5);
+    addDataBand(page.data(), minFunction, 7);
+    addDataBand(page.data(), maxFunction, -5);
+    addDataBand(page.data(), maxFunction, -7);
+    QCOMPARE(minFunction->calculate(page.data()).toDouble(), 5.0);
+    QCOMPARE(maxFunction->calculate(page.data()).toDouble(), -5.0);
+}
+
+void GroupFunctionsTest::testPageAvg()
+{
+    // The page AVG used to divide the page sum by the count of all values of
+    // the report; it divides by the count of values on the page now.
+    LimeReport::AvgGroupFunction avg(EXPRESSION, DATA_BAND_NAME, 0);
+    LimeReport::GroupFunction* gf = &avg;
+    LimeReport::PageItemDesignIntf::Ptr firstPage = LimeReport::PageItemDesignIntf::create(0);
+    addDataBand(firstPage.data(), gf, 10);
+    addDataBand(firstPage.data(), gf, 20);
+    LimeReport::PageItemDesignIntf::Ptr page = LimeReport::PageItemDesignIntf::create(0);
+    addDataBand(page.data(), gf, 2);
+    addDataBand(page.data(), gf, 4);
+    QCOMPARE(gf->calculate(page.data()).toDouble(), 3.0);
+    QCOMPARE(gf->calculate().toDouble(), 9.0);
+}
+
+void GroupFunctionsTest::testEmptyAvg()
+{
+    LimeReport::AvgGroupFunction avg(EXPRESSION, DATA_BAND_NAME, 0);
+    LimeReport::GroupFunction* gf = &avg;
+    QVERIFY(!gf->calculate().isValid());
+
+    LimeReport::PageItemDesignIntf::Ptr page = LimeReport::PageItemDesignIntf::create(0);
+    QVERIFY(!gf->calculate(page.data()).isValid());
+    addPageHeader(page.data());
+    QCOMPARE(gf->calculate(page.data()), QVariant(0.0));
+}
+
+void GroupFunctionsTest::testPopValue()
+{
+    LimeReport::MaxGroupFunction max(EXPRESSION, DATA_BAND_NAME, 0);
+    LimeReport::GroupFunction* gf = &max;
+    gf->pushValue(1);
+    gf->pushValue(5);
+    gf->pushValue(3);
+    gf->popValue();
+    QCOMPARE(gf->calculate().toDouble(), 5.0);
+    QCOMPARE(gf->values().count(), 2);
+    gf->popValue();
+    QCOMPARE(gf->calculate().toDouble(), 1.0);
+    gf->pushValue(3);
+    QCOMPARE(gf->calculate().toDouble(), 3.0);
+}
+
+void GroupFunctionsTest::testReRenderedBand()
+{
+    LimeReport::PageItemDesignIntf::Ptr page = LimeReport::PageItemDesignIntf::create(0);
+    LimeReport::SumGroupFunction sum(EXPRESSION, DATA_BAND_NAME, 0);
+    LimeReport::GroupFunction* gf = &sum;
+    addDataBand(page.data(), gf, 3);
+    QScopedPointer<LimeReport::DataBand> oldBand(new LimeReport::DataBand());
+    gf->pushValue(4);
+    oldBand->setGroupFunctionValue(gf, 4);
+
+    LimeReport::DataBand* newBand = new LimeReport::DataBand();
+    newBand->setBandIndex(page->childBands().count());
+    gf->slotBandReRendered(oldBand.data(), newBand);
+    QVERIFY(!oldBand->groupFunctionValues().contains(gf));
+    page->registerBand(newBand);
+    QCOMPARE(gf->calculate(page.data()).toDouble(), 7.0);
+}
+
+void GroupFunctionsTest::testRemovedBand()
+{
+    LimeReport::PageItemDesignIntf::Ptr page = LimeReport::PageItemDesignIntf::create(0);
+    LimeReport::MaxGroupFunction max(EXPRESSION, DATA_BAND_NAME, 0);
+    LimeReport::GroupFunction* gf = &max;
+    addDataBand(page.data(), gf, 3);
+    LimeReport::DataBand* band = addDataBand(page.data(), gf, 8);
+    QCOMPARE(gf->calculate(page.data()).toDouble(), 8.0);
+    delete band;
+    QCOMPARE(gf->calculate(page.data()).toDouble(), 3.0);
+}
+
+QTEST_MAIN(GroupFunctionsTest)
+
+#include "tst_groupfunctions.moc"
@@ -0,0 +1,8 @@
+include(../tests.pri)
+
+TARGET = tst_keeptogether
+
+SOURCES += \
+        tst_keeptogether.cpp
+
+DEFINES += SRCDIR=\\\"$$PWD/\\\"
@@ -0,0 +1,101 @@
+#include <QString>
+#include <QStringList>
+#include <QStandardItemModel>
+#include <QtTest>
+#include "../../limereport/lrreportengine.h"
+#include "../../limereport/lrdatasourcemanagerintf.h"
+#include "../../limereport/lrpagesinkintf.h"
+#include "../../limereport/lrpageitemdesignintf.h"
+#include "../../limereport/lritemdesignintf.h"
+
+namespace {
+
+const int GROUPS_COUNT = 40;
+
+// Collects the contents of the rendered pages, one list per page
+class PagesCollector : public LimeReport::IPageSink{
+public:
+    bool startPages(){ m_pages.clear(); return true; }
+    bool putPage(QSharedPointer<LimeReport::PageItemDesignIntf> page){
+        m_pages.append(QStringList());
+        collect(page.data());
+        return true;
+    }
+    bool finishPages(){ return true; }
+    QList<QStringList> pages() const { return m_pages; }
+private:
+    void collect(LimeReport::BaseDesignIntf* item){
+        foreach(LimeReport::BaseDesignIntf* child, item->childBaseItems()){
+            LimeReport::ContentItemDesignIntf* contentItem = dynamic_cast<LimeReport::ContentItemDesignIntf*>(child);
+            if (contentItem)
+                m_pages.last().append(contentItem->content());
+            collect(child);
+        }
+    }
+private:
+    QList<QStringList> m_pages;
+};
+
+} // namespace
+
+class KeepTogetherTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testGroupsOnOnePage();
+};
+
+void KeepTogetherTest::testGroupsOnOnePage()
+{
+    // groups of 3 to 12 rows, so that many of them don't fit on the rest of a page
+    QStandardItemModel model;
+    model.setHorizontalHeaderLabels(QStringList() << "Group" << "Name" << "Value");
+    int rowsCount = 0;
+    for (int group = 0; group < GROUPS_COUNT; ++group){
+        for (int i = 0; i < 3 + (group * 7) % 10; ++i){
+            QList<QStandardItem*> row;
+            row << new QStandardItem(QString("G%1").arg(group + 1))
+                << new QStandardItem(QString("row%1").arg(i + 1))
+                << new QStandardItem("1");
+            model.appendRow(row);
+            ++rowsCount;
+        }
+    }
+
+    LimeReport::ReportEngine report;
+    report.setRenderMode(LimeReport::HeadlessRenderMode);
+    report.dataManager()->addModel("rows", &model, false);
+    QVERIFY(report.loadFromFile(QString(SRCDIR) + "keeptogether_report.lrxml"));
+    PagesCollector collector;
+    QVERIFY(report.renderToPageSink(&collector));
+    QVERIFY(collector.pages().count() > 2);
+
+    QHash<QString, int> pageOfGroup;
+    int renderedRows = 0;
+    for (int page = 0; page < collector.pages().count(); ++page){
+        int pageRows = 0;
+        int pageSum = -1;
+        foreach(const QString& content, collector.pages().at(page)){
+            if (content.startsWith("Sum: ")){
+                pageSum = content.mid(5).toInt();
+            } else if (content.contains(':')){
+                // every row of a group is on the page of its first row
+                QString group = content.section(':', 0, 0);
+                if (!pageOfGroup.contains(group))
+                    pageOfGroup.insert(group, page);
+                QCOMPARE(pageOfGroup.value(group), page);
+                ++pageRows;
+            }
+        }
+        // the page footer counts the rows moved to the next page only there
+        QCOMPARE(pageSum, pageRows);
+        renderedRows += pageRows;
+    }
+    QCOMPARE(pageOfGroup.count(), GROUPS_COUNT);
+    QCOMPARE(renderedRows, rowsCount);
+}
+
+QTEST_MAIN(KeepTogetherTest)
+
+#include "tst_keeptogether.moc"
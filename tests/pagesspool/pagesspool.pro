@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_pagesspool
+
+SOURCES += \
+        tst_pagesspool.cpp
@@ -0,0 +1,64 @@
+#include <QString>
+#include <QtTest>
+#include "../../limereport/lrreportrender.h"
+#include "../../limereport/bands/lrdataband.h"
+#include "../../limereport/items/lrtextitem.h"
+
+namespace {
+
+const char* PAGE_CONTENT = "Page $V{#PAGE} of $V{#PAGE_COUNT}";
+
+LimeReport::PageItemDesignIntf::Ptr createPage(int pageNumber){
+    LimeReport::PageItemDesignIntf::Ptr page = LimeReport::PageItemDesignIntf::create(0);
+    LimeReport::DataBand* band = new LimeReport::DataBand(page.data(), page.data());
+    band->setObjectName("DataBand1");
+    LimeReport::TextItem* pageNumberItem = new LimeReport::TextItem(band, band);
+    pageNumberItem->setObjectName("TextItem1");
+    pageNumberItem->setContent(PAGE_CONTENT);
+    pageNumberItem->backupContent();
+    pageNumberItem->setContent(QString("Page %1 of 0").arg(pageNumber));
+    LimeReport::TextItem* staticItem = new LimeReport::TextItem(band, band);
+    staticItem->setObjectName("TextItem2");
+    staticItem->setContent("Static");
+    page->collectSecondPassItems();
+    return page;
+}
+
+} // namespace
+
+class PagesSpoolTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testRestoredSecondPassItems();
+};
+
+void PagesSpoolTest::testRestoredSecondPassItems()
+{
+    const int pagesCount = 5;
+    LimeReport::PagesSpool spool;
+    spool.setMaxPagesInMemory(1);
+    for (int i = 0; i < pagesCount; ++i)
+        spool.append(i, createPage(i + 1));
+
+    for (int i = 0; i < pagesCount; ++i){
+        LimeReport::PageItemDesignIntf::Ptr page;
+        QCOMPARE(spool.takeFirst(page), i);
+        QVERIFY(!page.isNull());
+        QCOMPARE(page->secondPassItems().count(), 1);
+        LimeReport::TextItem* pageNumberItem = page->findChild<LimeReport::TextItem*>("TextItem1");
+        QVERIFY(pageNumberItem);
+        QVERIFY(pageNumberItem->isContentBackedUp());
+        QCOMPARE(pageNumberItem->contentBackUp(), QString(PAGE_CONTENT));
+        QCOMPARE(pageNumberItem->content(), QString("Page %1 of 0").arg(i + 1));
+        LimeReport::TextItem* staticItem = page->findChild<LimeReport::TextItem*>("TextItem2");
+        QVERIFY(staticItem);
+        QVERIFY(!staticItem->isContentBackedUp());
+    }
+    QVERIFY(spool.isEmpty());
+}
+
+QTEST_MAIN(PagesSpoolTest)
+
+#include "tst_pagesspool.moc"
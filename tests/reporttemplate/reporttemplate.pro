@@ -0,0 +1,8 @@
+include(../tests.pri)
+
+TARGET = tst_reporttemplate
+
+SOURCES += \
+        tst_reporttemplate.cpp
+
+DEFINES += SRCDIR=\\\"$$PWD/\\\"
@@ -0,0 +1,87 @@
+#include <QString>
+#include <QtTest>
+#include "../../limereport/lrreportengine_p.h"
+#include "../../limereport/lrdatasourcemanager.h"
+#include "../../limereport/lrreporttranslation.h"
+#include "../../limereport/serializators/lrreporttemplate.h"
+
+namespace {
+
+const char* PASS_PHRASE = "template test";
+const char* PASSWORD = "secret";
+const char* TRANSLATED_CONTENT = "Bestellungen";
+
+// The report as the xml path loads it, with a crypted connection password
+// and a translation added to the items of the file
+QString reportXml(){
+    LimeReport::ReportEnginePrivate report;
+    report.setPassPhrase(PASS_PHRASE);
+    if (!report.loadFromFile(QString(SRCDIR) + "reporttemplate_report.lrxml", false)) return QString();
+    LimeReport::ConnectionDesc* connection = new LimeReport::ConnectionDesc();
+    connection->setName("orders");
+    connection->setDriver("QSQLITE");
+    connection->setDatabaseName(":memory:");
+    connection->setUserName("user");
+    connection->setPassword(PASSWORD);
+    report.dataManager()->addConnectionDesc(connection);
+    if (!report.addTranslationLanguage(QLocale::German)) return QString();
+    LimeReport::PageTranslation* pageTranslation = report.reportTranslation(QLocale::German)->findPageTranslation("page1");
+    if (!pageTranslation || !pageTranslation->itemsTranslation.contains("TextItem1")) return QString();
+    LimeReport::PropertyTranslation* content = pageTranslation->itemsTranslation.value("TextItem1")->findProperty("content");
+    if (!content) return QString();
+    content->value = TRANSLATED_CONTENT;
+    content->checked = true;
+    return report.saveToString();
+}
+
+// Loads the report and writes it again, the written xml shows the whole object tree
+QString reloadedXml(const QString& xml, bool templateCacheEnabled){
+    LimeReport::ReportEnginePrivate report;
+    report.setPassPhrase(PASS_PHRASE);
+    report.setTemplateCacheEnabled(templateCacheEnabled);
+    if (!report.loadFromString(xml)) return QString();
+    LimeReport::ConnectionDesc* connection = report.dataManager()->connectionByName("orders");
+    if (!connection || connection->password() != PASSWORD) return QString();
+    LimeReport::ReportTranslation* translation = report.reportTranslation(QLocale::German);
+    if (!translation) return QString();
+    LimeReport::PageTranslation* pageTranslation = translation->findPageTranslation("page1");
+    if (!pageTranslation || !pageTranslation->itemsTranslation.contains("TextItem1")) return QString();
+    LimeReport::PropertyTranslation* content = pageTranslation->itemsTranslation.value("TextItem1")->findProperty("content");
+    if (!content || content->value != TRANSLATED_CONTENT) return QString();
+    return report.saveToString();
+}
+
+} // namespace
+
+class ReportTemplateTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void testCachedTemplate();
+private:
+    QString m_xml;
+};
+
+void ReportTemplateTest::initTestCase()
+{
+    m_xml = reportXml();
+    QVERIFY(!m_xml.isEmpty());
+    QVERIFY(!m_xml.contains(PASSWORD));
+}
+
+void ReportTemplateTest::testCachedTemplate()
+{
+    LimeReport::ReportTemplateCache::instance().clear();
+    QString xml = reloadedXml(m_xml, false);
+    QVERIFY(!xml.isEmpty());
+    // the first load parses the template and replays it, the second one
+    // replays the cached template
+    QCOMPARE(reloadedXml(m_xml, true), xml);
+    QCOMPARE(reloadedXml(m_xml, true), xml);
+}
+
+QTEST_MAIN(ReportTemplateTest)
+
+#include "tst_reporttemplate.moc"
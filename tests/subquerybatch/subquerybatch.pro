@@ -0,0 +1,8 @@
+include(../tests.pri)
+
+QT += sql
+
+TARGET = tst_subquerybatch
+
+SOURCES += \
+        tst_subquerybatch.cpp
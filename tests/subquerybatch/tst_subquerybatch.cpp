@@ -0,0 +1,204 @@
+#include <QString>
+#include <QStringList>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QtTest>
+#include "../../limereport/lrreportengine.h"
+#include "../../limereport/lrdatasourcemanager.h"
+
+namespace {
+
+const int ORDERS_COUNT = 500;
+const int ITEMS_PER_ORDER = 3;
+const char* CONNECTION_NAME = "subquerybatch";
+
+// Every third order has no items, so empty detail blocks are covered too
+bool fillDatabase(){
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", CONNECTION_NAME);
+    db.setDatabaseName(":memory:");
+    if (!db.open()) return false;
+    QSqlQuery query(db);
+    if (!query.exec("create table orders (id integer primary key, customer text)")) return false;
+    if (!query.exec("create table items (id integer primary key, order_id integer, name text)")) return false;
+    db.transaction();
+    QSqlQuery insertOrder(db);
+    insertOrder.prepare("insert into orders (id, customer) values (?, ?)");
+    QSqlQuery insertItem(db);
+    insertItem.prepare("insert into items (order_id, name) values (?, ?)");
+    for (int i = 1; i <= ORDERS_COUNT; ++i){
+        insertOrder.addBindValue(i);
+        insertOrder.addBindValue(QString("Customer %1").arg(i));
+        insertOrder.exec();
+        if (i % 3 == 0) continue;
+        for (int j = 1; j <= ITEMS_PER_ORDER; ++j){
+            insertItem.addBindValue(i);
+            insertItem.addBindValue(QString("Item %1.%2").arg(i).arg(j));
+            insertItem.exec();
+        }
+    }
+    return db.commit();
+}
+
+// Walks the master rows the way a data band does and reads every detail row
+QStringList collectItems(LimeReport::DataSourceManager* dataManager){
+    QStringList result;
+    LimeReport::IDataSource* orders = dataManager->dataSource("orders");
+    if (!orders) return result;
+    for (orders->first(); !orders->eof(); orders->next()){
+        dataManager->updateChildrenData("orders");
+        LimeReport::IDataSource* items = dataManager->dataSource("items");
+        if (!items) return QStringList();
+        QStringList names;
+        for (items->first(); !items->eof(); items->next())
+            names.append(items->data("name").toString());
+        result.append(orders->data("id").toString() + ":" + names.join(","));
+    }
+    return result;
+}
+
+int executedQueries(LimeReport::DataSourceManager* dataManager){
+    LimeReport::SubQueryHolder* holder = dynamic_cast<LimeReport::SubQueryHolder*>(dataManager->dataSourceHolder("items"));
+    return holder ? holder->executedQueries() : -1;
+}
+
+} // namespace
+
+class SubQueryBatchTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void testBatchedRows_data();
+    void testBatchedRows();
+    void testChangedDetailRows();
+    void testFallbackToRowQueries_data();
+    void testFallbackToRowQueries();
+    void benchmarkSubQuery_data();
+    void benchmarkSubQuery();
+private:
+    LimeReport::ReportEngine* m_report;
+    LimeReport::DataSourceManager* m_dataManager;
+    QStringList m_baseline;
+};
+
+void SubQueryBatchTest::initTestCase()
+{
+    QVERIFY(fillDatabase());
+    init();
+    m_baseline = collectItems(m_dataManager);
+    cleanup();
+    QCOMPARE(m_baseline.count(), ORDERS_COUNT);
+    QCOMPARE(m_baseline.first(), QString("1:Item 1.1,Item 1.2,Item 1.3"));
+    QCOMPARE(m_baseline.at(2), QString("3:"));
+}
+
+void SubQueryBatchTest::init()
+{
+    m_report = new LimeReport::ReportEngine();
+    m_dataManager = dynamic_cast<LimeReport::DataSourceManager*>(m_report->dataManager());
+    QVERIFY(m_dataManager);
+    m_dataManager->addConnection(CONNECTION_NAME);
+    m_dataManager->addQuery("orders", "select id, customer from orders order by id", CONNECTION_NAME);
+    m_dataManager->addSubQuery("items", "select i.order_id, i.name from items i where i.order_id = $D{orders.id} order by i.name",
+                               CONNECTION_NAME, "orders");
+}
+
+void SubQueryBatchTest::cleanup()
+{
+    delete m_report;
+    m_report = 0;
+    m_dataManager = 0;
+}
+
+void SubQueryBatchTest::testBatchedRows_data()
+{
+    QTest::addColumn<int>("batchSize");
+    QTest::newRow("batch of 2") << 2;
+    QTest::newRow("batch of 7") << 7;
+    QTest::newRow("batch of 100") << 100;
+    QTest::newRow("batch of all orders") << ORDERS_COUNT * 2;
+}
+
+void SubQueryBatchTest::testBatchedRows()
+{
+    QFETCH(int, batchSize);
+    m_dataManager->setSubQueryBatchSize("items", batchSize);
+    int batchesCount = (ORDERS_COUNT + batchSize - 1) / batchSize;
+    int queries = executedQueries(m_dataManager);
+    QCOMPARE(collectItems(m_dataManager), m_baseline);
+    // a query which silently runs for every master row fails here
+    QCOMPARE(executedQueries(m_dataManager) - queries, batchesCount);
+    // the second pass starts from the first master row again, it is still
+    // in the batch when all orders are
+    queries = executedQueries(m_dataManager);
+    QCOMPARE(collectItems(m_dataManager), m_baseline);
+    QCOMPARE(executedQueries(m_dataManager) - queries, batchesCount > 1 ? batchesCount : 0);
+}
+
+void SubQueryBatchTest::testChangedDetailRows()
+{
+    m_dataManager->setSubQueryBatchSize("items", 100);
+    QCOMPARE(collectItems(m_dataManager), m_baseline);
+
+    QSqlQuery query(QSqlDatabase::database(CONNECTION_NAME));
+    QVERIFY(query.exec("insert into items (order_id, name) values (1, 'Item 1.4')"));
+    // a new render starts with all datasources set to the first row
+    m_dataManager->setAllDatasourcesToFirst();
+    QStringList items = collectItems(m_dataManager);
+    QVERIFY(query.exec("delete from items where name = 'Item 1.4'"));
+    QCOMPARE(items.first(), QString("1:Item 1.1,Item 1.2,Item 1.3,Item 1.4"));
+    QCOMPARE(items.mid(1), m_baseline.mid(1));
+}
+
+void SubQueryBatchTest::testFallbackToRowQueries_data()
+{
+    QTest::addColumn<QString>("sql");
+    QTest::newRow("master field in an expression")
+            << "select i.order_id, i.name from items i where i.order_id + 0 >= $D{orders.id} "
+               "and i.order_id <= $D{orders.id} order by i.name";
+    QTest::newRow("limit")
+            << "select i.order_id, i.name from items i where i.order_id = $D{orders.id} order by i.name limit 2";
+    QTest::newRow("or branch")
+            << "select i.order_id, i.name from items i where i.order_id = $D{orders.id} or i.name = 'Item 1.1' "
+               "order by i.name";
+    QTest::newRow("group by")
+            << "select i.order_id, count(*) as name from items i where i.order_id = $D{orders.id} "
+               "group by i.order_id";
+}
+
+void SubQueryBatchTest::testFallbackToRowQueries()
+{
+    QFETCH(QString, sql);
+    m_dataManager->removeDatasource("items");
+    m_dataManager->addSubQuery("items", sql, CONNECTION_NAME, "orders");
+    QStringList expected = collectItems(m_dataManager);
+    QCOMPARE(expected.count(), ORDERS_COUNT);
+    m_dataManager->setSubQueryBatchSize("items", 100);
+    int queries = executedQueries(m_dataManager);
+    QCOMPARE(collectItems(m_dataManager), expected);
+    QCOMPARE(executedQueries(m_dataManager) - queries, ORDERS_COUNT);
+}
+
+void SubQueryBatchTest::benchmarkSubQuery_data()
+{
+    QTest::addColumn<int>("batchSize");
+    QTest::newRow("row by row") << 0;
+    QTest::newRow("batch of 50") << 50;
+    QTest::newRow("batch of 200") << 200;
+}
+
+void SubQueryBatchTest::benchmarkSubQuery()
+{
+    QFETCH(int, batchSize);
+    m_dataManager->setSubQueryBatchSize("items", batchSize);
+    QBENCHMARK {
+        collectItems(m_dataManager);
+    }
+}
+
+QTEST_MAIN(SubQueryBatchTest)
+
+#include "tst_subquerybatch.moc"
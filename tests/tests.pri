@@ -0,0 +1,17 @@
+# Settings shared by the test projects in the subdirectories,
+# a project adds its TARGET, SOURCES and SRCDIR if it reads files
+QT       += testlib gui widgets
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include($$PWD/../common.pri)
+include($$PWD/../limereport/limereport.pri)
+
+INCLUDEPATH += $$ZINT_PATH/backend $$ZINT_PATH/backend_qt4
+DEPENDPATH += $$ZINT_PATH/backend $$ZINT_PATH/backend_qt4
+LIBS += -L$${DEST_LIBS} -lQtZint
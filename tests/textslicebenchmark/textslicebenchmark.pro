@@ -0,0 +1,6 @@
+include(../tests.pri)
+
+TARGET = tst_textslicebenchmark
+
+SOURCES += \
+        tst_textslicebenchmark.cpp
@@ -0,0 +1,111 @@
+#include <QString>
+#include <QStringList>
+#include <QtTest>
+#include "../../limereport/items/lrtextitem.h"
+
+namespace {
+
+const int LINES_PER_PAGE = 60;
+const int PAGE_HEIGHT = 1000;
+const qreal TEXT_WIDTH = 400;
+
+QStringList textLines(int pages){
+    QStringList result;
+    for (int i = 0; i < pages * LINES_PER_PAGE; ++i)
+        result.append(QString("Line %1 of the long memo field").arg(i + 1));
+    return result;
+}
+
+// A tall text item sliced into pages the way the report render does it
+class LongText{
+public:
+    LongText(int pages): m_lines(textLines(pages)){
+        m_item.setGeometry(QRectF(0, 0, TEXT_WIDTH, 20));
+        m_item.setAutoHeight(true);
+        m_item.setContent(m_lines.join("\n"));
+        m_item.setHeight(m_item.textSize().height());
+    }
+    QStringList slice(){
+        QStringList parts;
+        LimeReport::TextItem* part = &m_item;
+        while (part->height() > PAGE_HEIGHT && part->canBeSplitted(PAGE_HEIGHT)){
+            LimeReport::BaseDesignIntf* upperPart = part->cloneUpperPart(PAGE_HEIGHT, 0, 0);
+            LimeReport::TextItem* bottomPart = dynamic_cast<LimeReport::TextItem*>(part->cloneBottomPart(PAGE_HEIGHT, 0, 0));
+            parts.append(dynamic_cast<LimeReport::TextItem*>(upperPart)->content());
+            delete upperPart;
+            if (part != &m_item) delete part;
+            part = bottomPart;
+        }
+        parts.append(part->content());
+        if (part != &m_item) delete part;
+        return parts;
+    }
+    QStringList lines() const { return m_lines; }
+private:
+    LimeReport::TextItem m_item;
+    QStringList m_lines;
+};
+
+} // namespace
+
+class TextSliceBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testSlice();
+    void testLinearSlicing();
+    void benchmarkLongText_data();
+    void benchmarkLongText();
+};
+
+void TextSliceBenchmark::testSlice()
+{
+    LongText text(20);
+    QStringList parts = text.slice();
+    QVERIFY(parts.count() > 1);
+    QStringList lines;
+    foreach(QString part, parts){
+        foreach(QString line, part.split('\n')){
+            if (!line.isEmpty()) lines.append(line);
+        }
+    }
+    QCOMPARE(lines, text.lines());
+}
+
+void TextSliceBenchmark::testLinearSlicing()
+{
+    // every part is laid out from the document of the whole text, a slicing
+    // which laid out the rest of the text for every part would lay out about
+    // pages / 2 times the text
+    LongText text(500);
+    int characters = LimeReport::TextItem::laidOutCharacters();
+    QStringList parts = text.slice();
+    characters = LimeReport::TextItem::laidOutCharacters() - characters;
+    int textLength = text.lines().join("\n").length();
+    QVERIFY(parts.count() > 1);
+    QVERIFY2(characters <= textLength * 4,
+             qPrintable(QString("%1 characters laid out for a text of %2").arg(characters).arg(textLength)));
+}
+
+void TextSliceBenchmark::benchmarkLongText_data()
+{
+    QTest::addColumn<int>("pages");
+    QTest::newRow("50 pages") << 50;
+    QTest::newRow("100 pages") << 100;
+    QTest::newRow("250 pages") << 250;
+    QTest::newRow("500 pages") << 500;
+}
+
+void TextSliceBenchmark::benchmarkLongText()
+{
+    QFETCH(int, pages);
+    LongText text(pages);
+    QBENCHMARK {
+        text.slice();
+    }
+}
+
+QTEST_MAIN(TextSliceBenchmark)
+
+#include "tst_textslicebenchmark.moc"
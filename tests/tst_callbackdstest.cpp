@@ -19,6 +19,8 @@ protected Q_SLOTS:
 private Q_SLOTS:
     void testOneSlotDS();
     void testTwoSlotDS();
+    void testKeyFieldDS();
+    void testKeyFieldDSRowsLimit();
 
 };
 
@@ -255,6 +257,46 @@ void CallbackDSTest::testTwoSlotDS()
     QCOMPARE(m_test1DS->data("Value").toInt(),9);
 }
 
+void CallbackDSTest::testKeyFieldDS()
+{
+    LimeReport::CallbackDatasource ds;
+    connect(&ds, SIGNAL(getCallbackData(LimeReport::CallbackInfo,QVariant&)),
+            this, SLOT(slotGetCallbackData(LimeReport::CallbackInfo,QVariant&)));
+    connect(&ds, SIGNAL(changePos(LimeReport::CallbackInfo::ChangePosType,bool&)),
+            this, SLOT(slotChangePos(LimeReport::CallbackInfo::ChangePosType,bool&)));
+    QCOMPARE(ds.columnCount(), 2);
+    QCOMPARE(ds.dataByKeyField("Value", "Name", "Nissan").toInt(), 6);
+    QCOMPARE(ds.dataByKeyField("Value", "Name", "Mazda").toInt(), 0);
+    QCOMPARE(ds.dataByKeyField("Name", "Value", 7).toString(), QString("Nissan"));
+    QCOMPARE(ds.dataByKeyField("Name", "Value", 3).toString(), QString("Mazda"));
+    QVERIFY2(!ds.dataByKeyField("Value", "Name", "Toyota").isValid(), "Failure test absent key");
+    LimeReport::DataSourceStatistics statistics = ds.statistics();
+    QCOMPARE(statistics.keyIndexes, 2);
+    QCOMPARE(statistics.keyIndexEntries, 12);
+    QVERIFY(statistics.keyIndexMemory > 0);
+    // moving through the rows keeps the index, only changed data drops it
+    ds.first();
+    ds.next();
+    QCOMPARE(ds.dataByRowIndex("Name", 7).toString(), QString("Nissan"));
+    QCOMPARE(ds.statistics().keyIndexes, 2);
+    ds.invalidateKeyIndex();
+    QCOMPARE(ds.statistics().keyIndexes, 0);
+}
+
+void CallbackDSTest::testKeyFieldDSRowsLimit()
+{
+    LimeReport::CallbackDatasource ds;
+    connect(&ds, SIGNAL(getCallbackData(LimeReport::CallbackInfo,QVariant&)),
+            this, SLOT(slotTestOneSlotDS(LimeReport::CallbackInfo,QVariant&)));
+    QCOMPARE(ds.columnCount(), 2);
+    // the datasource has 10 rows, they are searched without being kept
+    ds.setMaxKeyIndexRows(5);
+    QCOMPARE(ds.dataByKeyField("Value", "Name", "Nissan").toInt(), 6);
+    QCOMPARE(ds.dataByKeyField("Name", "Value", 3).toString(), QString("Mazda"));
+    QCOMPARE(ds.statistics().keyIndexes, 0);
+    QCOMPARE(ds.statistics().keyIndexMemory, qint64(0));
+}
+
 QTEST_APPLESS_MAIN(CallbackDSTest)
 
 #include "tst_callbackdstest.moc"